@@ -0,0 +1,68 @@
+#ifndef JOS_BOOT_BOOT_H
+#define JOS_BOOT_BOOT_H
+
+// Definitions shared by the two stages of the boot loader.
+//
+// DISK LAYOUT
+//  sector 0				stage 1 (boot.S and main.c)
+//  sectors 1 .. BOOT2_NSECT		stage 2 (boot2.S, loader.c, ide.c, lz4.c)
+//  sectors KERN_SECT ..		the kernel image
+
+#define SECTSIZE	512
+#define MAXSECT		256	// most sectors one IDE command can read
+
+#ifndef BOOT2_NSECT
+# error "BOOT2_NSECT must be defined (see boot/Makefrag)"
+#endif
+
+#define BOOT2_ADDR	0x7E00		// stage 2 is loaded right above stage 1
+#define BOOT2_MAGIC	0x32544F42	// "BOT2" in little endian
+#define KERN_SECT	(1 + BOOT2_NSECT)
+
+// Bits of the primary IDE channel's status register (port 0x1F7)
+#define IDE_BSY		0x80
+#define IDE_DRDY	0x40
+#define IDE_DF		0x20
+#define IDE_DRQ		0x08
+#define IDE_ERR		0x01
+
+#ifndef __ASSEMBLER__
+
+#include <inc/types.h>
+#include <inc/x86.h>
+
+// The first bytes of stage 2.  boot/pad.pl fills in b2_cksum so that
+// the 32-bit words of the whole padded stage 2 sum to zero.
+struct Boot2hdr {
+	uint32_t b2_magic;	// must equal BOOT2_MAGIC
+	uint32_t b2_entry;	// where stage 1 jumps to
+	uint32_t b2_cksum;
+};
+
+// Wait until the primary IDE drive is not busy and is ready.  If
+// check_error, returns -1 if the drive reports a fault or an error.
+// Used by stage 2 and by the kernel's warm reload (kern/reload.c).
+static inline int
+ide_wait_ready(bool check_error)
+{
+	int r;
+
+	while (((r = inb(0x1F7)) & (IDE_BSY|IDE_DRDY)) != IDE_DRDY)
+		/* do nothing */;
+
+	if (check_error && (r & (IDE_DF|IDE_ERR)) != 0)
+		return -1;
+	return 0;
+}
+
+// boot/ide.c
+void	ide_init(void);
+int	ide_read(void *dst, uint32_t secno, uint32_t nsecs);
+bool	ide_dma(void);
+
+// boot/lz4.c
+int	lz4_decompress(void *dst, uint32_t dstlen, const void *src, uint32_t srclen);
+
+#endif /* !__ASSEMBLER__ */
+
+#endif /* !JOS_BOOT_BOOT_H */
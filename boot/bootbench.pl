@@ -0,0 +1,90 @@
+#!/usr/bin/perl
+
+# Boot each disk image under QEMU several times and report how many
+# bytes of kernel the boot loader reads and how long it takes to get
+# to the kernel monitor prompt.
+#
+#	usage: bootbench.pl qemu runs label disk kernel [label disk kernel ...]
+#
+# 'kernel' is what the disk holds at KERN_SECT: an ELF file, or an
+# image packed by boot/mkimage.
+
+use strict;
+use warnings;
+use IO::Select;
+use Time::HiRes qw(time);
+
+my ($qemu, $runs, @imgs) = @ARGV;
+die "usage: bootbench.pl qemu runs label disk kernel ...\n"
+	if !@imgs || @imgs % 3;
+
+# Bytes the loader reads for 'kernel': the packed size, or the ELF
+# header page plus the file size of every loadable segment.
+sub loadbytes {
+	my ($file) = @_;
+	my $buf;
+
+	open(K, $file) || die "open $file: $!";
+	binmode K;
+	read(K, $buf, -s $file);
+	close K;
+	return length($buf) if substr($buf, 0, 4) eq "KIMG";
+
+	my ($phoff) = unpack("V", substr($buf, 28, 4));
+	my ($phnum) = unpack("v", substr($buf, 44, 2));
+	my $n = 4096;
+	for (my $i = 0; $i < $phnum; $i++) {
+		my ($type, $off, $va, $pa, $filesz) =
+			unpack("V5", substr($buf, $phoff + 32 * $i, 20));
+		$n += $filesz if $type == 1;
+	}
+	return $n;
+}
+
+# Seconds from starting QEMU until the monitor prompt shows up
+# on the serial port.
+sub boot {
+	my ($disk) = @_;
+	my ($fh, $out, $buf, $t);
+
+	my $start = time;
+	my $pid = open($fh, "-|");
+	die "fork: $!" unless defined $pid;
+	if (!$pid) {
+		open(STDIN, "<", "/dev/null");
+		exec($qemu, "-display", "none", "-monitor", "none",
+		     "-serial", "stdio", "-no-reboot", "-drive",
+		     "file=$disk,index=0,media=disk,format=raw");
+		die "exec $qemu: $!";
+	}
+
+	my $sel = IO::Select->new($fh);
+	$out = "";
+	while ($sel->can_read(30) && sysread($fh, $buf, 4096)) {
+		$out .= $buf;
+		if ($out =~ /K> /) {
+			$t = time - $start;
+			last;
+		}
+	}
+	kill('TERM', $pid);
+	waitpid($pid, 0);
+	close($fh);
+	die "bootbench: $disk did not reach the kernel monitor\n"
+		unless defined $t;
+	return $t;
+}
+
+printf("%-8s %10s %8s %10s %10s\n", "image", "bytes", "sectors",
+       "best(ms)", "mean(ms)");
+while (my ($label, $disk, $kern) = splice(@imgs, 0, 3)) {
+	my ($best, $sum) = (1e9, 0);
+	for (my $i = 0; $i < $runs; $i++) {
+		my $t = boot($disk);
+		$best = $t if $t < $best;
+		$sum += $t;
+	}
+	my $n = loadbytes($kern);
+	printf("%-8s %10d %8d %10.1f %10.1f\n", $label, $n,
+	       int(($n + 511) / 512), 1000 * $best, 1000 * $sum / $runs);
+}
@@ -0,0 +1,278 @@
+/*
+ * Polled IDE disk driver for the second stage of the boot loader.
+ * Reads go to the primary master in LBA mode.  When built with
+ * BOOT_DMA, if there is a PCI bus-master IDE controller (such as the
+ * PIIX that QEMU emulates) and the drive has a DMA mode selected, the
+ * drive moves the data into memory by DMA.  Otherwise, or once a DMA
+ * transfer fails or takes too long, the CPU copies it in by PIO, using
+ * READ MULTIPLE when the drive accepts SET MULTIPLE MODE so that a
+ * whole block of sectors moves per DRQ, and plain READ SECTORS
+ * otherwise.
+ *
+ * Stage 2 never selects a DMA mode itself (SET FEATURES): the
+ * controller's timing registers, which are chipset-specific, would
+ * have to be set to match.  So DMA is used only if the BIOS already
+ * selected a multiword or Ultra DMA mode.  Where it left the drive
+ * in PIO mode, BOOT_DMA makes no difference.
+ */
+
+#include <inc/x86.h>
+#include <boot/boot.h>
+
+#define IDE_CMD_READ		0x20
+#define IDE_CMD_READ_MULTIPLE	0xC4
+#define IDE_CMD_READ_DMA	0xC8
+#define IDE_CMD_SET_MULTIPLE	0xC6
+#define IDE_CMD_IDENTIFY	0xEC
+
+// PCI configuration space access
+#define PCI_CONF_ADDR		0xCF8
+#define PCI_CONF_DATA		0xCFC
+#define PCI_COMMAND		0x04	// command register
+#define PCI_COMMAND_IO		0x0001
+#define PCI_COMMAND_MASTER	0x0004
+#define PCI_CLASS		0x08	// class, subclass, prog if, revision
+#define PCI_BAR4		0x20
+
+// Bus-master IDE registers, at offsets from BAR4 (primary channel)
+#define BM_CMD			0
+#define BM_CMD_START		0x01
+#define BM_CMD_WRITE		0x08	// DMA writes memory (disk reads)
+#define BM_STATUS		2
+#define BM_STATUS_ERR		0x02
+#define BM_STATUS_IRQ		0x04
+#define BM_PRDT			4
+
+// A physical region descriptor: one piece of a DMA transfer.
+// A piece must not cross a 64KB boundary.
+struct Prd {
+	uint32_t prd_addr;
+	uint16_t prd_count;	// bytes; 0 means 64KB
+	uint16_t prd_flags;
+};
+#define PRD_EOT		0x8000	// last entry of the table
+
+// How long a DMA transfer may take before we give up on DMA, in TSC
+// cycles (stage 2 does not know the TSC rate): 1s at 4.3GHz, longer
+// on slower CPUs.  A transfer of MAXSECT sectors takes milliseconds.
+#define IDE_DMA_TIMEOUT		(1ULL << 32)
+
+// Enough for MAXSECT sectors anywhere in memory.  The table itself
+// must not cross a 64KB boundary either.
+#define NPRD		(MAXSECT * SECTSIZE / 0x10000 + 1)
+static struct Prd prdt[NPRD] __attribute__((aligned(sizeof(struct Prd) * 4)));
+
+// Sectors per DRQ block for READ MULTIPLE, or 0 to use READ SECTORS
+static uint32_t ide_mult;
+
+// I/O base of the bus-master registers, or 0 to use PIO
+static uint32_t ide_bmbase;
+
+static void
+ide_command(uint32_t secno, uint32_t nsecs, uint8_t cmd)
+{
+	ide_wait_ready(0);
+
+	outb(0x1F2, nsecs);	// 0 means 256
+	outb(0x1F3, secno & 0xFF);
+	outb(0x1F4, (secno >> 8) & 0xFF);
+	outb(0x1F5, (secno >> 16) & 0xFF);
+	outb(0x1F6, 0xE0 | ((secno >> 24) & 0x0F));
+	outb(0x1F7, cmd);
+}
+
+static uint32_t
+pci_conf_read(uint32_t dev, uint32_t func, uint32_t reg)
+{
+	outl(PCI_CONF_ADDR, 0x80000000 | (dev << 11) | (func << 8) | reg);
+	return inl(PCI_CONF_DATA);
+}
+
+// Look for a bus-master IDE controller on PCI bus 0 whose primary
+// channel sits at the legacy ports, turn on its bus mastering, and
+// return the I/O base of its bus-master registers, or 0 if none.
+static uint32_t
+pci_find_bmide(void)
+{
+	uint32_t dev, func, class, bar;
+
+	for (dev = 0; dev < 32; dev++)
+		for (func = 0; func < 8; func++) {
+			if ((pci_conf_read(dev, func, 0) & 0xFFFF) == 0xFFFF)
+				continue;
+			// mass storage, IDE, bus master, primary in
+			// compatibility mode
+			class = pci_conf_read(dev, func, PCI_CLASS) >> 8;
+			if ((class >> 8) != 0x0101 || (class & 0x81) != 0x80)
+				continue;
+			bar = pci_conf_read(dev, func, PCI_BAR4);
+			if (!(bar & 1) || (bar & 0xFFFC) == 0)
+				continue;
+
+			outl(PCI_CONF_ADDR, 0x80000000 | (dev << 11)
+			     | (func << 8) | PCI_COMMAND);
+			outw(PCI_CONF_DATA, inw(PCI_CONF_DATA)
+			     | PCI_COMMAND_IO | PCI_COMMAND_MASTER);
+			return bar & 0xFFFC;
+		}
+	return 0;
+}
+
+// Whether IDENTIFY data 'id' says the drive does DMA and has a
+// multiword or Ultra DMA mode selected (by the BIOS: see above).
+static bool
+ide_dma_capable(const uint16_t *id)
+{
+	// word 49 bit 8: DMA supported
+	if (!(id[49] & 0x100))
+		return 0;
+	// word 63 bits 10:8: multiword DMA mode selected
+	if (id[63] & 0x700)
+		return 1;
+	// word 88 bits 14:8: Ultra DMA mode selected, if word 53 bit 2
+	// says word 88 is valid
+	return (id[53] & 0x4) && (id[88] & 0x7F00);
+}
+
+// Find out how many sectors the drive can move per DRQ block
+// and switch it to that multiple mode.  Use DMA if the drive
+// and a controller can.
+void
+ide_init(void)
+{
+	uint16_t id[SECTSIZE / 2];
+	uint32_t mult;
+
+	ide_mult = 0;
+	ide_bmbase = 0;
+
+	// Interrupts are off, but let the drive raise its interrupt line:
+	// that is what sets BM_STATUS_IRQ when a DMA transfer is done.
+	outb(0x3F6, 0);
+
+	ide_command(0, 0, IDE_CMD_IDENTIFY);
+	if (ide_wait_ready(1) < 0 || !(inb(0x1F7) & IDE_DRQ))
+		return;
+	insl(0x1F0, id, SECTSIZE / 4);
+
+#ifdef BOOT_DMA
+	if (ide_dma_capable(id))
+		ide_bmbase = pci_find_bmide();
+#endif
+
+	// IDENTIFY word 47 bits 7:0 hold the largest supported block
+	mult = id[47] & 0xFF;
+	if (mult < 2)
+		return;
+
+	ide_command(0, mult, IDE_CMD_SET_MULTIPLE);
+	if (ide_wait_ready(1) < 0)
+		return;
+	ide_mult = mult;
+}
+
+// Whether reads are (still) done by DMA
+bool
+ide_dma(void)
+{
+	return ide_bmbase != 0;
+}
+
+// Abandon a command the drive is stuck in: software reset.  The
+// reset may also turn off multiple mode, so go back to READ SECTORS.
+static void
+ide_reset(void)
+{
+	int i;
+
+	outb(0x3F6, 0x04);	// SRST, for at least 5us
+	for (i = 0; i < 32; i++)
+		inb(0x3F6);
+	outb(0x3F6, 0);
+	ide_mult = 0;
+	ide_wait_ready(0);
+}
+
+// Read 'nsecs' (at most MAXSECT) sectors by DMA.
+static int
+ide_dma_read(void *dst, uint32_t secno, uint32_t nsecs)
+{
+	uint32_t pa, len, n;
+	uint64_t start;
+	int i, r;
+
+	// one PRD per piece of the buffer between 64KB boundaries
+	pa = (uint32_t) dst;
+	len = nsecs * SECTSIZE;
+	for (i = 0; len > 0; i++) {
+		n = MIN(len, 0x10000 - (pa & 0xFFFF));
+		prdt[i].prd_addr = pa;
+		prdt[i].prd_count = n;	// 64KB truncates to 0, as it should
+		prdt[i].prd_flags = 0;
+		pa += n;
+		len -= n;
+	}
+	prdt[i - 1].prd_flags = PRD_EOT;
+
+	outb(ide_bmbase + BM_CMD, 0);
+	outb(ide_bmbase + BM_STATUS, BM_STATUS_ERR | BM_STATUS_IRQ);
+	outl(ide_bmbase + BM_PRDT, (uint32_t) prdt);
+	outb(ide_bmbase + BM_CMD, BM_CMD_WRITE);
+	ide_command(secno, nsecs, IDE_CMD_READ_DMA);
+	outb(ide_bmbase + BM_CMD, BM_CMD_WRITE | BM_CMD_START);
+
+	start = read_tsc();
+	while (!((r = inb(ide_bmbase + BM_STATUS))
+		 & (BM_STATUS_ERR | BM_STATUS_IRQ))
+	       && read_tsc() - start < IDE_DMA_TIMEOUT)
+		/* do nothing */;
+
+	outb(ide_bmbase + BM_CMD, 0);
+	outb(ide_bmbase + BM_STATUS, BM_STATUS_ERR | BM_STATUS_IRQ);
+	if (!(r & (BM_STATUS_ERR | BM_STATUS_IRQ))) {
+		// never finished
+		ide_reset();
+		return -1;
+	}
+	if ((r & BM_STATUS_ERR) || ide_wait_ready(1) < 0)
+		return -1;
+	return 0;
+}
+
+// Read 'nsecs' (at most MAXSECT) sectors by PIO.
+static int
+ide_pio_read(void *dst, uint32_t secno, uint32_t nsecs)
+{
+	uint32_t blk;
+
+	ide_command(secno, nsecs, ide_mult ? IDE_CMD_READ_MULTIPLE
+					   : IDE_CMD_READ);
+
+	// the disk raises DRQ once per block
+	for (; nsecs > 0; nsecs -= blk) {
+		blk = ide_mult ? MIN(nsecs, ide_mult) : 1;
+		if (ide_wait_ready(1) < 0)
+			return -1;
+		insl(0x1F0, dst, blk * SECTSIZE / 4);
+		dst += blk * SECTSIZE;
+	}
+	return 0;
+}
+
+// Read 'nsecs' sectors starting at sector 'secno' into 'dst'.
+int
+ide_read(void *dst, uint32_t secno, uint32_t nsecs)
+{
+	uint32_t n;
+
+	for (; nsecs > 0; secno += n, nsecs -= n, dst += n * SECTSIZE) {
+		n = MIN(nsecs, MAXSECT);
+		if (ide_bmbase && ide_dma_read(dst, secno, n) == 0)
+			continue;
+		// no DMA, or it failed: use PIO from here on
+		ide_bmbase = 0;
+		if (ide_pio_read(dst, secno, n) < 0)
+			return -1;
+	}
+	return 0;
+}
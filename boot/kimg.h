@@ -0,0 +1,49 @@
+#ifndef JOS_BOOT_KIMG_H
+#define JOS_BOOT_KIMG_H
+
+// Packed kernel image format, written by boot/mkimage.c and read by
+// the second stage of the boot loader (boot/loader.c).  The loader
+// also accepts a plain ELF kernel.
+//
+// The first sector of the image holds a struct Kimghdr.  Each of its
+// segments is a run of memory holding one or more of the kernel's ELF
+// segments, with any holes between them filled in with zeroes, so that
+// the loader can read it straight into place in one go.  The data of
+// each segment starts in its own sector, ks_sect sectors into the
+// image, right after the data of the one before it.  Uncompressed data
+// starts ks_pa % SECTSIZE bytes into that sector, so that reading
+// whole sectors to ROUNDDOWN(ks_pa, SECTSIZE) puts it in place; LZ4
+// data starts at the beginning of the sector.  Segments are sorted by
+// load address, and no two share a sector of memory.
+//
+// Like inc/elf.h, this header expects uint32_t to be defined already,
+// so that it can be used by both the loader and the host-side tool.
+
+#define KIMG_MAGIC	0x474D494B	// "KIMG" in little endian
+#define KIMG_MAXSEG	8
+
+// Flag bits for Kimgseg::ks_flags
+#define KS_LZ4		0x1		// data is one LZ4 block
+
+// How far past the end of its output an LZ4 block must sit for
+// decompressing it in place (forwards) to never overwrite input
+// that has not been read yet.
+#define LZ4_INPLACE_MARGIN(csize)	(((csize) >> 8) + 32)
+
+struct Kimgseg {
+	uint32_t ks_pa;		// load address
+	uint32_t ks_filesz;	// bytes of data, once decompressed
+	uint32_t ks_memsz;	// bytes of memory; zero-filled past ks_filesz
+	uint32_t ks_sect;	// first sector of the data, from image start
+	uint32_t ks_disksz;	// bytes of data on disk
+	uint32_t ks_flags;
+};
+
+struct Kimghdr {
+	uint32_t k_magic;	// must equal KIMG_MAGIC
+	uint32_t k_entry;	// physical entry point
+	uint32_t k_nseg;
+	struct Kimgseg k_seg[KIMG_MAXSEG];
+};
+
+#endif /* !JOS_BOOT_KIMG_H */
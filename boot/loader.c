@@ -0,0 +1,220 @@
+#include <inc/x86.h>
+#include <inc/elf.h>
+#include <inc/bootinfo.h>
+#include <boot/boot.h>
+#include <boot/kimg.h>
+
+/**********************************************************************
+ * The second stage of the boot loader, whose job is to boot a
+ * kernel image from the first IDE hard disk.
+ *
+ *  * The kernel image starts at sector KERN_SECT (see boot/boot.h).
+ *
+ *  * The kernel image is either packed by boot/mkimage.c (see
+ *    boot/kimg.h), possibly with LZ4-compressed segments, or a plain
+ *    ELF file.  A packed image is laid out so that each segment takes
+ *    a single sequential read; an ELF file is the slower fallback.
+ *
+ * Stage 1 (main.c) jumps to start2 in boot2.S, which calls loadmain()
+ * below in 32-bit protected mode, with paging off and an identity
+ * segment mapping.  A running kernel may do the same to reload itself
+ * (kern/reload.c), in which case 'warmboot' is WARMBOOT_MAGIC.
+ **********************************************************************/
+
+#define SCRATCH		0x10000
+#define ELFHDR		((struct Elf *) SCRATCH)
+#define KIMGHDR		((struct Kimghdr *) SCRATCH)
+#define BOOTINFO	((struct Bootinfo *) BOOTINFO_PA)
+
+uint32_t load_kimg(void);
+uint32_t load_elf(void);
+int readseg(uint32_t, uint32_t, uint32_t);
+void zeroseg(uint32_t, uint32_t);
+
+void
+loadmain(uint32_t warmboot)
+{
+	uint32_t entry;
+	int i;
+
+	BOOTINFO->bi_magic = 0;
+	BOOTINFO->bi_flags = 0;
+	if (warmboot == WARMBOOT_MAGIC)
+		BOOTINFO->bi_flags |= BI_WARM;
+	BOOTINFO->bi_tsc[BT_BOOT2] = read_tsc();
+	for (i = BT_BOOT2 + 1; i < BT_NPHASE; i++)
+		BOOTINFO->bi_tsc[i] = 0;
+
+	ide_init();
+
+	// read 1st sector off disk: all of a packed image's header
+	if (readseg(SCRATCH, SECTSIZE, 0) < 0)
+		goto bad;
+
+	// is this a packed image or a valid ELF?
+	if (KIMGHDR->k_magic == KIMG_MAGIC)
+		entry = load_kimg();
+	else if (ELFHDR->e_magic == ELF_MAGIC) {
+		// the ELF loader wants the rest of the 1st page
+		if (readseg(SCRATCH + SECTSIZE, SECTSIZE*7, SECTSIZE) < 0)
+			goto bad;
+		entry = load_elf();
+	} else
+		goto bad;
+	if (entry == 0)
+		goto bad;
+
+	// tell the kernel it need not clear its BSS again
+	BOOTINFO->bi_flags |= BI_BSS_CLEAR;
+	if (ide_dma())
+		BOOTINFO->bi_flags |= BI_DISK_DMA;
+	BOOTINFO->bi_magic = BOOTINFO_MAGIC;
+	BOOTINFO->bi_tsc[BT_LOADED] = read_tsc();
+
+	// call the entry point
+	// note: does not return!
+	((void (*)(void)) entry)();
+
+bad:
+	outw(0x8A00, 0x8A00);
+	outw(0x8A00, 0x8E00);
+	while (1)
+		/* do nothing */;
+}
+
+// Load a packed image whose header is at KIMGHDR.
+// Returns the entry point, or 0 on failure.
+uint32_t
+load_kimg(void)
+{
+	struct Kimgseg *ks, *eks;
+	uint32_t src;
+
+	if (KIMGHDR->k_nseg > KIMG_MAXSEG)
+		return 0;
+	ks = KIMGHDR->k_seg;
+	eks = ks + KIMGHDR->k_nseg;
+
+	// Segments come sorted by load address, so each may scribble
+	// past its own end: whatever lands there is overwritten by a
+	// later segment or zeroed below.
+	for (; ks < eks; ks++) {
+		if (!(ks->ks_flags & KS_LZ4)) {
+			// the data is as far into its sector as ks_pa is
+			if (readseg(ks->ks_pa, ks->ks_disksz,
+				    ks->ks_sect * SECTSIZE
+				    + ks->ks_pa % SECTSIZE) < 0)
+				return 0;
+			continue;
+		}
+
+		// Read the compressed block into the segment's own memory,
+		// far enough towards its end that decompressing it forward
+		// in place never overwrites input that is still unread.
+		src = ROUNDUP(ks->ks_pa + ks->ks_filesz
+			      + LZ4_INPLACE_MARGIN(ks->ks_disksz)
+			      - ks->ks_disksz, SECTSIZE);
+		if (readseg(src, ks->ks_disksz, ks->ks_sect * SECTSIZE) < 0)
+			return 0;
+		if (lz4_decompress((void *) ks->ks_pa, ks->ks_filesz,
+				   (void *) src, ks->ks_disksz) != ks->ks_filesz)
+			return 0;
+	}
+
+	for (ks = KIMGHDR->k_seg; ks < eks; ks++)
+		if (ks->ks_memsz > ks->ks_filesz)
+			zeroseg(ks->ks_pa + ks->ks_filesz,
+				ks->ks_memsz - ks->ks_filesz);
+
+	return KIMGHDR->k_entry;
+}
+
+// Load an ELF kernel whose first page is at ELFHDR.
+// Returns the entry point, or 0 on failure.
+uint32_t
+load_elf(void)
+{
+	struct Proghdr *ph, *eph;
+	uint32_t pa, end_pa, offset;
+
+	// load each program segment (ignores ph flags)
+	ph = (struct Proghdr *) ((uint8_t *) ELFHDR + ELFHDR->e_phoff);
+	eph = ph + ELFHDR->e_phnum;
+	while (ph < eph) {
+		if (ph->p_type != ELF_PROG_LOAD) {
+			ph++;
+			continue;
+		}
+
+		// p_pa is the load address of this segment (as well
+		// as the physical address).  Only its first p_filesz
+		// bytes come from the disk.  Segments that follow it
+		// at the same distance in memory as on disk are read
+		// together with it, in one run.
+		pa = ph->p_pa;
+		offset = ph->p_offset;
+		end_pa = pa + ph->p_filesz;
+		for (ph++; ph < eph && ph->p_type == ELF_PROG_LOAD
+			     && ph->p_pa >= end_pa
+			     && ph->p_pa - pa == ph->p_offset - offset; ph++)
+			end_pa = ph->p_pa + ph->p_filesz;
+
+		if (readseg(pa, end_pa - pa, offset) < 0)
+			return 0;
+	}
+
+	// Zero the rest of each segment (the BSS) only after all reads,
+	// since readseg writes whole sectors and may run past the end
+	// of what it was asked for.
+	ph = (struct Proghdr *) ((uint8_t *) ELFHDR + ELFHDR->e_phoff);
+	for (; ph < eph; ph++)
+		if (ph->p_type == ELF_PROG_LOAD && ph->p_memsz > ph->p_filesz)
+			zeroseg(ph->p_pa + ph->p_filesz,
+				ph->p_memsz - ph->p_filesz);
+
+	return ELFHDR->e_entry;
+}
+
+// Read 'count' bytes at 'offset' from kernel into physical address 'pa'.
+// Might copy more than asked
+int
+readseg(uint32_t pa, uint32_t count, uint32_t offset)
+{
+	uint32_t end_pa;
+
+	end_pa = pa + count;
+
+	// round down to sector boundary
+	pa &= ~(SECTSIZE - 1);
+
+	// translate from bytes to sectors
+	offset = (offset / SECTSIZE) + KERN_SECT;
+
+	// We'd write more to memory than asked, but it doesn't matter --
+	// we load in increasing order.  Since we haven't enabled paging
+	// yet and we're using an identity segment mapping (see boot.S),
+	// we can use physical addresses directly.
+	if (pa >= end_pa)
+		return 0;
+	return ide_read((uint8_t *) pa, offset,
+			(end_pa - pa + SECTSIZE - 1) / SECTSIZE);
+}
+
+// Zero 'count' bytes at physical address 'pa', a dword at a time
+// for all but the last few bytes.
+void
+zeroseg(uint32_t pa, uint32_t count)
+{
+	uint32_t n;
+
+	n = count / 4;
+	asm volatile("cld; rep stosl"
+		     : "+D" (pa), "+c" (n)
+		     : "a" (0)
+		     : "cc", "memory");
+	n = count % 4;
+	asm volatile("rep stosb"
+		     : "+D" (pa), "+c" (n)
+		     : "a" (0)
+		     : "cc", "memory");
+}
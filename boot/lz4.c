@@ -0,0 +1,78 @@
+/*
+ * Decompressor for raw LZ4 blocks, as produced by boot/mkimage.c.
+ * It copies strictly front to back, so a block can be decompressed
+ * in place when it sits LZ4_INPLACE_MARGIN bytes past the end of
+ * its output (see boot/kimg.h).
+ */
+
+#include <inc/x86.h>
+#include <boot/boot.h>
+
+// Forward byte copy.  Overlapping matches rely on the
+// byte-at-a-time semantics of rep movsb.
+static void
+copy(uint8_t **dst, const uint8_t **src, uint32_t n)
+{
+	asm volatile("cld; rep movsb"
+		     : "+D" (*dst), "+S" (*src), "+c" (n)
+		     : : "cc", "memory");
+}
+
+// Read the extra length bytes that follow a length of 15 in a token.
+static int
+getlen(const uint8_t **ip, const uint8_t *iend, uint32_t *len)
+{
+	uint32_t b;
+
+	do {
+		if (*ip >= iend)
+			return -1;
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+	return 0;
+}
+
+// Decompress the 'srclen'-byte LZ4 block at 'src' into at most
+// 'dstlen' bytes at 'dst'.  Returns the number of bytes produced,
+// or -1 if the block is malformed.
+int
+lz4_decompress(void *dst, uint32_t dstlen, const void *src, uint32_t srclen)
+{
+	const uint8_t *ip = src, *iend = ip + srclen, *match;
+	uint8_t *op = dst, *oend = op + dstlen;
+	uint32_t token, len, off;
+
+	while (ip < iend) {
+		token = *ip++;
+
+		// literals
+		len = token >> 4;
+		if (len == 15 && getlen(&ip, iend, &len) < 0)
+			return -1;
+		if (len > iend - ip || len > oend - op)
+			return -1;
+		copy(&op, &ip, len);
+
+		// the last sequence has no match
+		if (ip == iend)
+			break;
+
+		// match: 16-bit offset back into the output, then length
+		if (iend - ip < 2)
+			return -1;
+		off = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (off == 0 || off > op - (uint8_t *) dst)
+			return -1;
+		len = token & 15;
+		if (len == 15 && getlen(&ip, iend, &len) < 0)
+			return -1;
+		len += 4;
+		if (len > oend - op)
+			return -1;
+		match = op - off;
+		copy(&op, &match, len);
+	}
+	return op - (uint8_t *) dst;
+}
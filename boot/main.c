@@ -1,17 +1,18 @@
 #include <inc/x86.h>
-#include <inc/elf.h>
+#include <boot/boot.h>
 
 /**********************************************************************
- * This a dirt simple boot loader, whose sole job is to boot
- * an ELF kernel image from the first IDE hard disk.
+ * This is the first stage of the boot loader, whose sole job is to
+ * load the second stage from the first IDE hard disk and jump to it.
  *
  * DISK LAYOUT
- *  * This program(boot.S and main.c) is the bootloader.  It should
+ *  * This program(boot.S and main.c) is the first stage.  It should
  *    be stored in the first sector of the disk.
  *
- *  * The 2nd sector onward holds the kernel image.
+ *  * The next BOOT2_NSECT sectors hold the second stage (boot2.S,
+ *    loader.c, ide.c and lz4.c), which loads the kernel.
  *
- *  * The kernel image must be in ELF format.
+ *  * Sector KERN_SECT onward holds the kernel image.
  *
  * BOOT UP STEPS
  *  * when the CPU boots it loads the BIOS into memory and executes it
@@ -26,38 +27,37 @@
  *  * control starts in boot.S -- which sets up protected mode,
  *    and a stack so C code then run, then calls bootmain()
  *
- *  * bootmain() in this file takes over, reads in the kernel and jumps to it.
+ *  * bootmain() in this file reads in the second stage, checks it,
+ *    and jumps to it.  loadmain() in loader.c then loads the kernel.
  **********************************************************************/
 
-#define SECTSIZE	512
-#define ELFHDR		((struct Elf *) 0x10000) // scratch space
+#define BOOT2HDR	((struct Boot2hdr *) BOOT2_ADDR)
 
-void readsect(void*, uint32_t);
-void readseg(uint32_t, uint32_t, uint32_t);
+void readsects(void*, uint32_t, uint32_t);
 
 void
 bootmain(void)
 {
-	struct Proghdr *ph, *eph;
+	uint32_t *p, sum;
 
-	// read 1st page off disk
-	readseg((uint32_t) ELFHDR, SECTSIZE*8, 0);
+	// read the second stage, which follows this sector on the disk
+	readsects(BOOT2HDR, 1, BOOT2_NSECT);
 
-	// is this a valid ELF?
-	if (ELFHDR->e_magic != ELF_MAGIC)
+	// is this a valid second stage?
+	if (BOOT2HDR->b2_magic != BOOT2_MAGIC)
 		goto bad;
 
-	// load each program segment (ignores ph flags)
-	ph = (struct Proghdr *) ((uint8_t *) ELFHDR + ELFHDR->e_phoff);
-	eph = ph + ELFHDR->e_phnum;
-	for (; ph < eph; ph++)
-		// p_pa is the load address of this segment (as well
-		// as the physical address)
-		readseg(ph->p_pa, ph->p_memsz, ph->p_offset);
+	// did it arrive intact?  (see boot/pad.pl)
+	sum = 0;
+	for (p = (uint32_t *) BOOT2HDR;
+	     p < (uint32_t *) (BOOT2_ADDR + BOOT2_NSECT * SECTSIZE); p++)
+		sum += *p;
+	if (sum != 0)
+		goto bad;
 
-	// call the entry point from the ELF header
+	// call the second stage
 	// note: does not return!
-	((void (*)(void)) (ELFHDR->e_entry))();
+	((void (*)(void)) (BOOT2HDR->b2_entry))();
 
 bad:
 	outw(0x8A00, 0x8A00);
@@ -66,60 +66,36 @@ bad:
 		/* do nothing */;
 }
 
-// Read 'count' bytes at 'offset' from kernel into physical address 'pa'.
-// Might copy more than asked
-void
-readseg(uint32_t pa, uint32_t count, uint32_t offset)
-{
-	uint32_t end_pa;
-
-	end_pa = pa + count;
-
-	// round down to sector boundary
-	pa &= ~(SECTSIZE - 1);
-
-	// translate from bytes to sectors, and kernel starts at sector 1
-	offset = (offset / SECTSIZE) + 1;
-
-	// If this is too slow, we could read lots of sectors at a time.
-	// We'd write more to memory than asked, but it doesn't matter --
-	// we load in increasing order.
-	while (pa < end_pa) {
-		// Since we haven't enabled paging yet and we're using
-		// an identity segment mapping (see boot.S), we can
-		// use physical addresses directly.  This won't be the
-		// case once JOS enables the MMU.
-		readsect((uint8_t*) pa, offset);
-		pa += SECTSIZE;
-		offset++;
-	}
-}
-
 void
 waitdisk(void)
 {
 	// wait for disk reaady
-	while ((inb(0x1F7) & 0xC0) != 0x40)
+	while ((inb(0x1F7) & (IDE_BSY|IDE_DRDY)) != IDE_DRDY)
 		/* do nothing */;
 }
 
+// Read 'nsect' (1 to MAXSECT) consecutive sectors starting at 'offset'
+// with a single READ SECTORS command.
 void
-readsect(void *dst, uint32_t offset)
+readsects(void *dst, uint32_t offset, uint32_t nsect)
 {
 	// wait for disk to be ready
 	waitdisk();
 
-	outb(0x1F2, 1);		// count = 1
+	outb(0x1F2, nsect);	// count; 0 means 256
 	outb(0x1F3, offset);
 	outb(0x1F4, offset >> 8);
 	outb(0x1F5, offset >> 16);
 	outb(0x1F6, (offset >> 24) | 0xE0);
 	outb(0x1F7, 0x20);	// cmd 0x20 - read sectors
 
-	// wait for disk to be ready
-	waitdisk();
+	// the disk raises DRQ once per sector
+	while (nsect-- > 0) {
+		// wait for disk to be ready
+		waitdisk();
 
-	// read a sector
-	insl(0x1F0, dst, SECTSIZE/4);
+		// read a sector
+		insl(0x1F0, dst, SECTSIZE/4);
+		dst += SECTSIZE;
+	}
 }
-
@@ -0,0 +1,302 @@
+/*
+ * Host-side tool: pack the loadable segments of an ELF kernel into
+ * the image format of boot/kimg.h, for the second stage of the boot
+ * loader to load.  Segments that lie close together in memory are
+ * merged into one contiguous run, which is optionally LZ4-compressed.
+ *
+ *	usage: mkimage [-z] kernel image
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include <inc/elf.h>
+#include <boot/kimg.h>
+
+#define SECTSIZE	512
+#define ROUNDUP(n, m)	(((n) + (m) - 1) / (m) * (m))
+
+// LZ4 format limits: the last match must start at least 12 bytes
+// before the end of the block and end at least 5 bytes before it.
+#define LZ4_MFLIMIT	12
+#define LZ4_LASTLITERALS 5
+#define LZ4_HASHLOG	16
+
+// Largest hole between two segments that is filled in with zeroes
+// on disk so that both can be loaded as one run.
+#define MAXGAP		4096
+
+static void
+panic(const char *msg, const char *arg)
+{
+	fprintf(stderr, "mkimage: %s%s%s\n", msg, arg ? ": " : "",
+		arg ? arg : "");
+	exit(1);
+}
+
+static void *
+readfile(const char *path, size_t *size)
+{
+	FILE *f;
+	void *buf;
+	long n;
+
+	if ((f = fopen(path, "rb")) == NULL)
+		panic(strerror(errno), path);
+	fseek(f, 0, SEEK_END);
+	n = ftell(f);
+	rewind(f);
+	if ((buf = malloc(n)) == NULL || fread(buf, 1, n, f) != (size_t) n)
+		panic("read failed", path);
+	fclose(f);
+	*size = n;
+	return buf;
+}
+
+static uint32_t
+read32(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static uint8_t *
+putlen(uint8_t *op, size_t len)
+{
+	for (; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+	return op;
+}
+
+static uint8_t *
+putseq(uint8_t *op, const uint8_t *lit, size_t nlit, size_t off, size_t mlen)
+{
+	uint8_t *token = op++;
+
+	*token = (nlit < 15 ? nlit : 15) << 4;
+	if (nlit >= 15)
+		op = putlen(op, nlit - 15);
+	memcpy(op, lit, nlit);
+	op += nlit;
+	if (mlen == 0)
+		return op;
+
+	*op++ = off;
+	*op++ = off >> 8;
+	mlen -= 4;
+	*token |= mlen < 15 ? mlen : 15;
+	if (mlen >= 15)
+		op = putlen(op, mlen - 15);
+	return op;
+}
+
+// Greedy LZ4 block compressor with a single-entry hash table.
+// 'dst' must have room for n + n/255 + 16 bytes.
+static size_t
+lz4_compress(const uint8_t *src, size_t n, uint8_t *dst)
+{
+	static int64_t table[1 << LZ4_HASHLOG];
+	size_t ip, anchor, len, h;
+	int64_t ref;
+	uint8_t *op = dst;
+
+	for (h = 0; h < (1 << LZ4_HASHLOG); h++)
+		table[h] = -1;
+
+	ip = anchor = 0;
+	while (n > LZ4_MFLIMIT && ip < n - LZ4_MFLIMIT) {
+		h = (read32(src + ip) * 2654435761U) >> (32 - LZ4_HASHLOG);
+		ref = table[h];
+		table[h] = ip;
+		if (ref < 0 || ip - ref > 65535
+		    || read32(src + ref) != read32(src + ip)) {
+			ip++;
+			continue;
+		}
+		for (len = 4; ip + len < n - LZ4_LASTLITERALS
+			     && src[ref + len] == src[ip + len]; len++)
+			/* do nothing */;
+		op = putseq(op, src + anchor, ip - anchor, ip - ref, len);
+		ip += len;
+		anchor = ip;
+	}
+	op = putseq(op, src + anchor, n - anchor, 0, 0);
+	return op - dst;
+}
+
+// Check that 'c' decompresses to 'raw', laid out in one buffer the
+// way the boot loader does it: output at 0, input ending at least
+// LZ4_INPLACE_MARGIN bytes past the end of the output, and the
+// output never catching up with input that is still unread.
+static int
+lz4_verify_inplace(const uint8_t *raw, size_t n, const uint8_t *c, size_t clen)
+{
+	size_t start = n + LZ4_INPLACE_MARGIN(clen) - clen;
+	uint8_t *buf = calloc(1, start + clen);
+	size_t ip = start, op = 0, len, off, b;
+	int token, ok = 0;
+
+	if (buf == NULL)
+		goto out;
+	memcpy(buf + start, c, clen);
+	while (ip < start + clen) {
+		token = buf[ip++];
+		len = token >> 4;
+		if (len == 15)
+			do len += (b = buf[ip++]); while (b == 255);
+		memmove(buf + op, buf + ip, len);
+		op += len, ip += len;
+		if (ip == start + clen)
+			break;
+		off = buf[ip] | (buf[ip + 1] << 8);
+		ip += 2;
+		len = token & 15;
+		if (len == 15)
+			do len += (b = buf[ip++]); while (b == 255);
+		len += 4;
+		if (off == 0 || off > op || op + len > ip)
+			goto out;
+		for (; len > 0; len--, op++)
+			buf[op] = buf[op - off];
+	}
+	ok = (op == n && memcmp(buf, raw, n) == 0);
+out:
+	free(buf);
+	return ok;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct Elf *elf;
+	struct Proghdr *ph;
+	struct Kimghdr kh;
+	struct Kimgseg *seg, *ks, tmp;
+	uint8_t *kern, **data, *run, *z;
+	size_t kernsz, zlen, raw, packed, *datalen;
+	uint32_t i, j, nseg, sect, lead;
+	int compress = 0;
+	FILE *f;
+
+	if (argc == 4 && strcmp(argv[1], "-z") == 0) {
+		compress = 1;
+		argc--, argv++;
+	}
+	if (argc != 3) {
+		fprintf(stderr, "usage: mkimage [-z] kernel image\n");
+		exit(2);
+	}
+
+	kern = readfile(argv[1], &kernsz);
+	elf = (struct Elf *) kern;
+	if (kernsz < sizeof(*elf) || elf->e_magic != ELF_MAGIC)
+		panic("not an ELF file", argv[1]);
+
+	// collect the loadable segments, sorted by load address
+	seg = calloc(elf->e_phnum + 1, sizeof(*seg));
+	nseg = 0;
+	ph = (struct Proghdr *) (kern + elf->e_phoff);
+	for (i = 0; i < elf->e_phnum; i++, ph++) {
+		if (ph->p_type != ELF_PROG_LOAD || ph->p_memsz == 0)
+			continue;
+		if (ph->p_offset + ph->p_filesz > kernsz)
+			panic("segment past end of file", argv[1]);
+		ks = &seg[nseg++];
+		ks->ks_pa = ph->p_pa;
+		ks->ks_filesz = ph->p_filesz;
+		ks->ks_memsz = ph->p_memsz;
+		ks->ks_sect = ph->p_offset;	// file offset, for now
+	}
+	for (i = 1; i < nseg; i++)
+		for (j = i; j > 0 && seg[j].ks_pa < seg[j-1].ks_pa; j--) {
+			tmp = seg[j];
+			seg[j] = seg[j-1];
+			seg[j-1] = tmp;
+		}
+
+	// Pack them into as few contiguous runs as we can: a segment
+	// joins the run before it if the hole in between, which is
+	// stored on disk as zeroes, is at most MAXGAP bytes.
+	memset(&kh, 0, sizeof(kh));
+	kh.k_magic = KIMG_MAGIC;
+	kh.k_entry = elf->e_entry;
+	ks = NULL;
+	for (i = 0; i < nseg; i++) {
+		if (ks && seg[i].ks_pa >= ks->ks_pa + ks->ks_memsz
+		    && seg[i].ks_pa - (ks->ks_pa + ks->ks_filesz) <= MAXGAP) {
+			ks->ks_filesz = seg[i].ks_pa + seg[i].ks_filesz - ks->ks_pa;
+			ks->ks_memsz = seg[i].ks_pa + seg[i].ks_memsz - ks->ks_pa;
+			continue;
+		}
+		if (kh.k_nseg == KIMG_MAXSEG)
+			panic("too many segments", argv[1]);
+		ks = &kh.k_seg[kh.k_nseg++];
+		ks->ks_pa = seg[i].ks_pa;
+		ks->ks_filesz = seg[i].ks_filesz;
+		ks->ks_memsz = seg[i].ks_memsz;
+	}
+
+	// Lay out the data back to back, each run on its own sectors.
+	// Uncompressed data starts as far into its first sector as the
+	// run starts into a sector of memory (see kimg.h).
+	data = calloc(kh.k_nseg, sizeof(*data));
+	datalen = calloc(kh.k_nseg, sizeof(*datalen));
+	sect = 1;
+	raw = packed = 0;
+	for (i = 0, j = 0; i < kh.k_nseg; i++) {
+		ks = &kh.k_seg[i];
+		lead = ks->ks_pa % SECTSIZE;
+		// the lead-in is read over memory below ks_pa
+		if (i > 0 && ks->ks_pa - lead < ks[-1].ks_pa + ks[-1].ks_memsz)
+			panic("runs share a sector", argv[1]);
+		data[i] = calloc(1, lead + ks->ks_filesz + 1);
+		run = data[i] + lead;
+		for (; j < nseg && seg[j].ks_pa < ks->ks_pa + ks->ks_memsz; j++)
+			memcpy(run + (seg[j].ks_pa - ks->ks_pa),
+			       kern + seg[j].ks_sect, seg[j].ks_filesz);
+		ks->ks_disksz = ks->ks_filesz;
+		datalen[i] = lead + ks->ks_filesz;
+		if (compress && ks->ks_filesz > 0) {
+			z = malloc(ks->ks_filesz + ks->ks_filesz / 255 + 16);
+			zlen = lz4_compress(run, ks->ks_filesz, z);
+			// keep it only if it saves sectors
+			if (ROUNDUP(zlen, SECTSIZE) < ROUNDUP(datalen[i], SECTSIZE)) {
+				if (!lz4_verify_inplace(run, ks->ks_filesz,
+							z, zlen))
+					panic("LZ4 self-check failed", argv[1]);
+				data[i] = z;
+				datalen[i] = ks->ks_disksz = zlen;
+				ks->ks_flags |= KS_LZ4;
+			}
+		}
+		ks->ks_sect = sect;
+		sect += ROUNDUP(datalen[i], SECTSIZE) / SECTSIZE;
+		raw += ks->ks_filesz;
+		packed += ks->ks_disksz;
+	}
+
+	if ((f = fopen(argv[2], "wb")) == NULL)
+		panic(strerror(errno), argv[2]);
+	fwrite(&kh, sizeof(kh), 1, f);
+	for (i = 0; i < kh.k_nseg; i++) {
+		fseek(f, kh.k_seg[i].ks_sect * SECTSIZE, SEEK_SET);
+		fwrite(data[i], 1, datalen[i], f);
+	}
+	// pad the last sector
+	fseek(f, sect * SECTSIZE - 1, SEEK_SET);
+	fputc(0, f);
+	if (fclose(f) != 0)
+		panic(strerror(errno), argv[2]);
+
+	fprintf(stderr, "kernel image is %u sectors: %u run%s, %zu bytes "
+		"stored in %zu bytes (%s)\n", sect, kh.k_nseg,
+		kh.k_nseg == 1 ? "" : "s", raw, packed,
+		compress ? "lz4" : "raw");
+	return 0;
+}
@@ -0,0 +1,31 @@
+#!/usr/bin/perl
+
+# Pad the second-stage boot loader to exactly $ARGV[1] sectors and
+# store a checksum in its header (struct Boot2hdr in boot/boot.h)
+# so that the 32-bit words of the padded image sum to zero.
+
+open(BB, $ARGV[0]) || die "open $ARGV[0]: $!";
+my $max = 512 * $ARGV[1];
+
+binmode BB;
+my $buf;
+read(BB, $buf, $max + 1);
+$n = length($buf);
+
+if($n > $max){
+	print STDERR "stage 2 too large: $n bytes (max $max)\n";
+	exit 1;
+}
+
+print STDERR "stage 2 is $n bytes (max $max)\n";
+
+$buf .= "\0" x ($max-$n);
+
+my $sum = 0;
+$sum = ($sum + $_) % 4294967296 foreach unpack("V*", $buf);
+substr($buf, 8, 4) = pack("V", (4294967296 - $sum) % 4294967296);
+
+open(BB, ">$ARGV[0]") || die "open >$ARGV[0]: $!";
+binmode BB;
+print BB $buf;
+close BB;
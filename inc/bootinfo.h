@@ -0,0 +1,51 @@
+#ifndef JOS_INC_BOOTINFO_H
+#define JOS_INC_BOOTINFO_H
+
+#ifndef __ASSEMBLER__
+#include <inc/types.h>
+#endif /* not __ASSEMBLER__ */
+
+// The boot loader leaves a struct Bootinfo at physical address
+// BOOTINFO_PA for the kernel.  Kernels started some other way
+// (e.g., by GRUB) find no BOOTINFO_MAGIC there and must not trust
+// the rest of the block.
+
+#define BOOTINFO_PA	0x1000		// free low memory below the loader
+#define BOOTINFO_MAGIC	0x4F464E49	// "INFO" in little endian
+
+// Values for Bootinfo::bi_flags
+#define BI_BSS_CLEAR	0x0001		// loader zeroed p_memsz beyond p_filesz
+#define BI_DISK_DMA	0x0002		// loader read the kernel by DMA
+#define BI_WARM		0x0004		// reloaded by a running kernel
+
+// The BIOS warm boot flag.  The kernel sets it (entry.S) so that a
+// reset skips the BIOS memory test; stage 1 of the boot loader clears
+// it, so stage 2 finds it set only when a running kernel reloads it
+// (see kern/reload.c) without going through the BIOS.
+#define WARMBOOT_ADDR	0x472
+#define WARMBOOT_MAGIC	0x1234
+
+// Boot phases, as indexes into Bootinfo::bi_tsc.  Each slot holds
+// the time stamp counter when that phase began.
+#define BT_BOOT1	0		// stage 1 (boot.S), or kernel reload
+#define BT_BOOT2	1		// stage 2 (loadmain)
+#define BT_LOADED	2		// kernel loaded, jumping to it
+#define BT_ENTRY	3		// kernel entry (entry.S)
+#define BT_INIT		4		// i386_init
+#define BT_CONS		5		// console initialized
+#define BT_NPHASE	6
+
+// Physical address of bi_tsc[phase], for assembly code
+#define BOOTINFO_TSC(phase)	(BOOTINFO_PA + 8 + 8 * (phase))
+
+#ifndef __ASSEMBLER__
+
+struct Bootinfo {
+	uint32_t bi_magic;	// must equal BOOTINFO_MAGIC
+	uint32_t bi_flags;
+	uint64_t bi_tsc[BT_NPHASE];
+};
+
+#endif /* !__ASSEMBLER__ */
+
+#endif /* !JOS_INC_BOOTINFO_H */
@@ -86,6 +86,12 @@
 // All physical memory mapped at this address
 #define	KERNBASE	0xF0000000
 
+// Physical memory that entry.S maps at KERNBASE until the kernel sets
+// up its own page tables (see kern/entrypgdir.c).  A multiple of PTSIZE,
+// and at most 256MB, which reaches the top of the address space.  Only
+// the first 4MB are mapped if the CPU lacks 4MB pages.
+#define ENTRYMEM	(64 * 1024 * 1024)
+
 // At IOPHYSMEM (640K) there is a 384K hole for I/O.  From the kernel,
 // IOPHYSMEM can be addressed at KERNBASE + IOPHYSMEM.  The hole ends
 // at physical address EXTPHYSMEM.
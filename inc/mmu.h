@@ -88,7 +88,10 @@
 #define CR0_CD		0x40000000	// Cache Disable
 #define CR0_PG		0x80000000	// Paging
 
+#define CR4_OSXMMEXCPT	0x00000400	// OS handles SIMD exceptions
+#define CR4_OSFXSR	0x00000200	// OS saves state with FXSAVE (enables SSE)
 #define CR4_PCE		0x00000100	// Performance counter enable
+#define CR4_PGE		0x00000080	// Page Global Enable
 #define CR4_MCE		0x00000040	// Machine Check Enable
 #define CR4_PSE		0x00000010	// Page Size Extensions
 #define CR4_DE		0x00000008	// Debugging Extensions
@@ -96,6 +99,19 @@
 #define CR4_PVI		0x00000002	// Protected-Mode Virtual Interrupts
 #define CR4_VME		0x00000001	// V86 Mode Extensions
 
+// CPUID function 1 %edx feature flags
+#define CPUID_PSE	0x00000008	// Page Size Extensions
+#define CPUID_TSC	0x00000010	// Time Stamp Counter
+#define CPUID_PGE	0x00002000	// Page Global Enable
+#define CPUID_FXSR	0x01000000	// FXSAVE and FXRSTOR
+#define CPUID_SSE2	0x04000000	// SSE2
+
+// CPUID function 7 %ebx feature flags
+#define CPUID7_ERMS	0x00000200	// Enhanced REP MOVSB/STOSB
+
+// CPUID function 0x80000007 %edx feature flags
+#define CPUIDX_INVTSC	0x00000100	// TSC runs at a constant rate
+
 // Eflags register
 #define FL_CF		0x00000001	// Carry Flag
 #define FL_PF		0x00000004	// Parity Flag
@@ -1,6 +1,7 @@
 #ifndef JOS_INC_STDIO_H
 #define JOS_INC_STDIO_H
 
+#include <inc/types.h>
 #include <inc/stdarg.h>
 
 #ifndef NULL
@@ -9,12 +10,15 @@
 
 // lib/console.c
 void	cputchar(int c);
+void	cputs(const char *str, size_t len);
 int	getchar(void);
 int	iscons(int fd);
 
 // lib/printfmt.c
 void	printfmt(void (*putch)(int, void*), void *putdat, const char *fmt, ...);
 void	vprintfmt(void (*putch)(int, void*), void *putdat, const char *fmt, va_list);
+void	vprintfmt_write(void (*putch)(int, void*), void (*write)(const char*, size_t, void*),
+			void *putdat, const char *fmt, va_list);
 int	snprintf(char *str, int size, const char *fmt, ...);
 int	vsnprintf(char *str, int size, const char *fmt, va_list);
 
@@ -20,6 +20,27 @@ void *	memmove(void *dst, const void *src, size_t len);
 int	memcmp(const void *s1, const void *s2, size_t len);
 void *	memfind(const void *s, int c, size_t len);
 
+void *	memset_generic(void *dst, int c, size_t len);
+void *	memcpy_generic(void *dst, const void *src, size_t len);
+int	memcmp_generic(const void *s1, const void *s2, size_t len);
+extern void *(*memset_impl)(void *dst, int c, size_t len);
+extern void *(*memcpy_impl)(void *dst, const void *src, size_t len);
+extern int (*memcmp_impl)(const void *s1, const void *s2, size_t len);
+
+// Copies and fills of a small constant size are done inline, in a few
+// moves, rather than by a call: with -fno-builtin GCC will not do this
+// for plain memcpy and memset, but it still does for the __builtin_
+// versions.  Other sizes call the functions.  lib/string.c #undefs
+// these to define the functions themselves.
+#define STRING_INLINE_MAX	32
+
+#define memcpy(dst, src, len)						\
+	(__builtin_constant_p(len) && (len) <= STRING_INLINE_MAX	\
+	 ? __builtin_memcpy(dst, src, len) : (memcpy)(dst, src, len))
+#define memset(dst, c, len)						\
+	(__builtin_constant_p(len) && (len) <= STRING_INLINE_MAX	\
+	 ? __builtin_memset(dst, c, len) : (memset)(dst, c, len))
+
 long	strtol(const char *s, char **endptr, int base);
 
 #endif /* not JOS_INC_STRING_H */
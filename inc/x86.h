@@ -227,9 +227,10 @@ static inline void
 cpuid(uint32_t info, uint32_t *eaxp, uint32_t *ebxp, uint32_t *ecxp, uint32_t *edxp)
 {
 	uint32_t eax, ebx, ecx, edx;
+	// %ecx selects sub-leaf 0 of functions that have sub-leaves
 	asm volatile("cpuid"
 		     : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
-		     : "a" (info));
+		     : "a" (info), "c" (0));
 	if (eaxp)
 		*eaxp = eax;
 	if (ebxp)
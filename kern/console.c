@@ -5,11 +5,12 @@
 #include <inc/kbdreg.h>
 #include <inc/string.h>
 #include <inc/assert.h>
+#include <inc/error.h>
 
 #include <kern/console.h>
+#include <kern/klog.h>
 
 static void cons_intr(int (*proc)(void));
-static void cons_putc(int c);
 
 // Stupid I/O delay routine necessitated by historical PC design flaws
 static void
@@ -31,8 +32,13 @@ delay(void)
 #define COM_DLM		1	// Out: Divisor Latch High (DLAB=1)
 #define COM_IER		1	// Out: Interrupt Enable Register
 #define   COM_IER_RDI	0x01	//   Enable receiver data interrupt
+#define   COM_IER_THRI	0x02	//   Enable transmitter empty interrupt
 #define COM_IIR		2	// In:	Interrupt ID Register
+#define   COM_IIR_FIFO	0xC0	//   FIFOs enabled (16550A)
 #define COM_FCR		2	// Out: FIFO Control Register
+#define   COM_FCR_ENABLE 0x01	//   Enable FIFOs
+#define   COM_FCR_CLR_RX 0x02	//   Clear receive FIFO
+#define   COM_FCR_CLR_TX 0x04	//   Clear transmit FIFO
 #define COM_LCR		3	// Out: Line Control Register
 #define	  COM_LCR_DLAB	0x80	//   Divisor latch access bit
 #define	  COM_LCR_WLEN8	0x03	//   Wordlength: 8 bits
@@ -42,64 +48,167 @@ delay(void)
 #define	  COM_MCR_OUT2	0x08	// Out2 complement
 #define COM_LSR		5	// In:	Line Status Register
 #define   COM_LSR_DATA	0x01	//   Data available
+#define   COM_LSR_OE	0x02	//   Overrun error
 #define   COM_LSR_TXRDY	0x20	//   Transmit buffer avail
 #define   COM_LSR_TSRE	0x40	//   Transmitter off
 
+#if COM_BAUD <= 0 || 115200 % COM_BAUD != 0
+# error "COM_BAUD must divide 115200"
+#endif
+
+// Output waits in a ring buffer until the transmitter has room for it,
+// so that writing never has to wait for the line.  Whenever the
+// transmitter is empty, the next burst of up to a FIFO's worth of bytes
+// goes out: from serial_write itself, which polls for that on every
+// call and so works with interrupts off (early boot, panic, and all of
+// lab 1), and from the THRE interrupt, which is enabled while there is
+// anything left to send.
+#define SERIAL_TXBUFSIZE 1024
+
+static struct {
+	uint8_t buf[SERIAL_TXBUFSIZE];
+	uint32_t rpos;		// free running; index with % SERIAL_TXBUFSIZE
+	uint32_t wpos;
+} serial_tx;
+
 static bool serial_exists;
+static int serial_fifo;		// bytes the transmitter takes at once
+static uint8_t serial_ier;	// current COM_IER value
+
+struct Serialstat serialstat;
 
 static int
 serial_proc_data(void)
 {
-	if (!(inb(COM1+COM_LSR) & COM_LSR_DATA))
+	uint8_t lsr = inb(COM1+COM_LSR);
+
+	if (lsr & COM_LSR_OE)
+		serialstat.ss_rxoverrun++;
+	if (!(lsr & COM_LSR_DATA))
 		return -1;
 	return inb(COM1+COM_RX);
 }
 
+// Refill the transmitter from the ring buffer for as long as it is
+// empty.  A real UART takes one burst and is busy for a while after;
+// an emulated one is often ready again at once, and then all of the
+// ring goes out now rather than waiting for the next call.
+static void
+serial_tx_drain(void)
+{
+	uint32_t n, m, i;
+	uint8_t ier;
+
+	// a burst at a time, in two pieces if it wraps around the ring
+	while (serial_tx.rpos != serial_tx.wpos
+	       && (inb(COM1+COM_LSR) & COM_LSR_TXRDY)) {
+		n = MIN((uint32_t) serial_fifo, serial_tx.wpos - serial_tx.rpos);
+		while (n > 0) {
+			i = serial_tx.rpos % SERIAL_TXBUFSIZE;
+			m = MIN(n, SERIAL_TXBUFSIZE - i);
+			outsb(COM1+COM_TX, &serial_tx.buf[i], m);
+			serial_tx.rpos += m;
+			n -= m;
+		}
+	}
+
+	// ask for a THRE interrupt only while there is more to send
+	ier = COM_IER_RDI;
+	if (serial_tx.rpos != serial_tx.wpos)
+		ier |= COM_IER_THRI;
+	if (ier != serial_ier)
+		outb(COM1+COM_IER, serial_ier = ier);
+}
+
 void
 serial_intr(void)
 {
-	if (serial_exists)
+	if (serial_exists) {
 		cons_intr(serial_proc_data);
+		serial_tx_drain();
+	}
 }
 
 static void
-serial_putc(int c)
+serial_write(const char *buf, size_t n)
 {
+	uint32_t room;
 	int i;
 
-	for (i = 0;
-	     !(inb(COM1 + COM_LSR) & COM_LSR_TXRDY) && i < 12800;
-	     i++)
-		delay();
+	while (n > 0) {
+		// Logging outruns the line: wait for the transmitter to
+		// take the next burst.  Drop the rest if it never does.
+		if (serial_tx.wpos - serial_tx.rpos == SERIAL_TXBUFSIZE) {
+			serialstat.ss_txfull++;
+			for (i = 0;
+			     !(inb(COM1 + COM_LSR) & COM_LSR_TXRDY) && i < 12800;
+			     i++)
+				delay();
+			serial_tx_drain();
+			if (serial_tx.wpos - serial_tx.rpos == SERIAL_TXBUFSIZE) {
+				serialstat.ss_txdrop += n;
+				return;
+			}
+		}
 
-	outb(COM1 + COM_TX, c);
+		room = SERIAL_TXBUFSIZE - (serial_tx.wpos - serial_tx.rpos);
+		for (; room > 0 && n > 0; room--, n--)
+			serial_tx.buf[serial_tx.wpos++ % SERIAL_TXBUFSIZE] = *buf++;
+		serial_tx_drain();
+	}
 }
 
+// Send everything in the ring buffer by polling, and wait until
+// the transmitter is done with it.  Gives up if the transmitter
+// stops taking bytes.
 static void
+serial_flush(void)
+{
+	uint32_t rpos;
+	int i;
+
+	for (i = 0; i < 12800; i++) {
+		rpos = serial_tx.rpos;
+		serial_tx_drain();
+		if (serial_tx.rpos != rpos)
+			i = 0;
+		else if (serial_tx.rpos == serial_tx.wpos
+			 && (inb(COM1 + COM_LSR) & COM_LSR_TSRE))
+			break;
+		delay();
+	}
+}
+
+static bool
 serial_init(void)
 {
-	// Turn off the FIFO
-	outb(COM1+COM_FCR, 0);
+	// Turn on and clear the FIFOs (16550A and later)
+	outb(COM1+COM_FCR, COM_FCR_ENABLE | COM_FCR_CLR_RX | COM_FCR_CLR_TX);
 
 	// Set speed; requires DLAB latch
 	outb(COM1+COM_LCR, COM_LCR_DLAB);
-	outb(COM1+COM_DLL, (uint8_t) (115200 / 9600));
-	outb(COM1+COM_DLM, 0);
+	outb(COM1+COM_DLL, (uint8_t) (115200 / COM_BAUD));
+	outb(COM1+COM_DLM, (uint8_t) ((115200 / COM_BAUD) >> 8));
 
 	// 8 data bits, 1 stop bit, parity off; turn off DLAB latch
 	outb(COM1+COM_LCR, COM_LCR_WLEN8 & ~COM_LCR_DLAB);
 
 	// No modem controls
 	outb(COM1+COM_MCR, 0);
-	// Enable rcv interrupts
-	outb(COM1+COM_IER, COM_IER_RDI);
+	// Enable rcv interrupts; transmit interrupts come and go
+	serial_ier = COM_IER_RDI;
+	outb(COM1+COM_IER, serial_ier);
 
 	// Clear any preexisting overrun indications and interrupts
 	// Serial port doesn't exist if COM_LSR returns 0xFF
 	serial_exists = (inb(COM1+COM_LSR) != 0xFF);
-	(void) inb(COM1+COM_IIR);
+	// Older UARTs have no FIFO and take one byte at a time
+	serial_fifo = (inb(COM1+COM_IIR) & COM_IIR_FIFO) == COM_IIR_FIFO ? 16 : 1;
 	(void) inb(COM1+COM_RX);
 
+	serialstat.ss_baud = COM_BAUD;
+	serialstat.ss_fifo = serial_fifo;
+	return serial_exists;
 }
 
 
@@ -120,21 +229,92 @@ lpt_putc(int c)
 	outb(0x378+2, 0x08);
 }
 
+static void
+lpt_write(const char *buf, size_t n)
+{
+	while (n-- > 0)
+		lpt_putc(*buf++);
+}
+
+// The data register of a parallel port reads back what was written
+// to it; with no port there, reads return 0xFF.
+static bool
+lpt_init(void)
+{
+	outb(0x378+0, 0xAA);
+	if (inb(0x378+0) != 0xAA)
+		return 0;
+	outb(0x378+0, 0x55);
+	return inb(0x378+0) == 0x55;
+}
+
+
+
+
+/***** QEMU debug console output *****/
+// Bytes written to port 0xE9 go wherever QEMU's -debugcon option sends
+// them (see DEBUGCON in GNUmakefile), with no status to wait for.
+
+#define DEBUGCON	0xE9
+
+static void
+debugcon_write(const char *buf, size_t n)
+{
+	outsb(DEBUGCON, buf, n);
+}
+
+// The port reads back as 0xE9 when it is there.
+static bool
+debugcon_init(void)
+{
+	return inb(DEBUGCON) == DEBUGCON;
+}
 
 
 
 /***** Text-mode CGA/VGA display output *****/
 
+// Output goes to crt_shadow, a copy of the screen in ordinary memory,
+// and marks its lines dirty in crt_dirty.  cga_flush then copies the
+// dirty lines to the display buffer and moves the cursor, once for a
+// whole burst of output.
+//
+// The screen shows CRT_SIZE cells of the display buffer, starting at
+// crt_origin; crt_pos is relative to that.  To scroll, we move the
+// origin down (6845 registers 12 and 13) rather than copy the screen
+// up, until the screen would run off the end of the buffer: only then
+// does it get copied back to the start.  A mono buffer has no room
+// beyond the screen, so there we always copy.
 static unsigned addr_6845;
 static uint16_t *crt_buf;
 static uint16_t crt_pos;
+static uint16_t crt_origin;
+static uint16_t crt_cells;	// size of crt_buf
+static uint16_t crt_cursor;	// cursor as last shown, in crt_buf
+
+static uint16_t crt_shadow[CRT_SIZE];
+static uint32_t crt_dirty;	// bit i: line i of crt_shadow changed
+static uint32_t crt_scrolled;	// lines crt_shadow scrolled since the flush
+// Attribute for characters that come without one: black on white,
+// unless cputchar was given a color
+static uint16_t cga_attr = 0x0700;
 
 static void
+crt_set_origin(uint16_t origin)
+{
+	crt_origin = origin;
+	outb(addr_6845, 12);
+	outb(addr_6845 + 1, origin >> 8);
+	outb(addr_6845, 13);
+	outb(addr_6845 + 1, origin);
+}
+
+static bool
 cga_init(void)
 {
 	volatile uint16_t *cp;
 	uint16_t was;
-	unsigned pos;
+	unsigned pos, origin;
 
 	cp = (uint16_t*) (KERNBASE + CGA_BUF);
 	was = *cp;
@@ -142,9 +322,11 @@ cga_init(void)
 	if (*cp != 0xA55A) {
 		cp = (uint16_t*) (KERNBASE + MONO_BUF);
 		addr_6845 = MONO_BASE;
+		crt_cells = CRT_SIZE;
 	} else {
 		*cp = was;
 		addr_6845 = CGA_BASE;
+		crt_cells = CGA_CELLS;
 	}
 
 	/* Extract cursor location */
@@ -153,24 +335,45 @@ cga_init(void)
 	outb(addr_6845, 15);
 	pos |= inb(addr_6845 + 1);
 
+	/* and the origin, which a kernel before a reload may have moved */
+	outb(addr_6845, 12);
+	origin = inb(addr_6845 + 1) << 8;
+	outb(addr_6845, 13);
+	origin |= inb(addr_6845 + 1);
+
 	crt_buf = (uint16_t*) cp;
-	crt_pos = pos;
+	if (origin + CRT_SIZE > crt_cells) {
+		memmove(crt_buf, crt_buf + crt_cells - CRT_SIZE,
+			CRT_SIZE * sizeof(uint16_t));
+		origin = 0;
+	}
+	crt_set_origin(origin);
+	crt_pos = (pos >= origin && pos < origin + CRT_SIZE) ? pos - origin : 0;
+	crt_cursor = pos;
+
+	memmove(crt_shadow, crt_buf + crt_origin, sizeof(crt_shadow));
+	crt_dirty = 0;
+	crt_scrolled = 0;
+	return 1;
 }
 
 
 
+static void cga_scroll(void);
+
 static void
 cga_putc(int c)
 {
-	// if no attribute given, then use black on white
+	// if no attribute given, then use cga_attr
 	if (!(c & ~0xFF))
-		c |= 0x0700;
+		c |= cga_attr;
 
 	switch (c & 0xff) {
 	case '\b':
 		if (crt_pos > 0) {
 			crt_pos--;
-			crt_buf[crt_pos] = (c & ~0xff) | ' ';
+			crt_shadow[crt_pos] = (c & ~0xff) | ' ';
+			crt_dirty |= 1 << (crt_pos / CRT_COLS);
 		}
 		break;
 	case '\n':
@@ -180,32 +383,107 @@ cga_putc(int c)
 		crt_pos -= (crt_pos % CRT_COLS);
 		break;
 	case '\t':
-		cons_putc(' ');
-		cons_putc(' ');
-		cons_putc(' ');
-		cons_putc(' ');
-		cons_putc(' ');
+		cga_putc(' ');
+		cga_putc(' ');
+		cga_putc(' ');
+		cga_putc(' ');
+		cga_putc(' ');
 		break;
 	default:
-		crt_buf[crt_pos++] = c;		/* write the character */
+		crt_dirty |= 1 << (crt_pos / CRT_COLS);
+		crt_shadow[crt_pos++] = c;	/* write the character */
 		break;
 	}
 
-	// What is the purpose of this?
-	if (crt_pos >= CRT_SIZE) {
-		int i;
+	if (crt_pos >= CRT_SIZE)
+		cga_scroll();
+}
+
+// Scroll up a line once the cursor runs off the bottom.  The lines
+// that move up keep their dirty bits; the new one is dirty.
+static void
+cga_scroll(void)
+{
+	int i;
+
+	memmove(crt_shadow, crt_shadow + CRT_COLS,
+		(CRT_SIZE - CRT_COLS) * sizeof(uint16_t));
+	for (i = CRT_SIZE - CRT_COLS; i < CRT_SIZE; i++)
+		crt_shadow[i] = 0x0700 | ' ';
+	crt_dirty = (crt_dirty >> 1) | (1 << (CRT_ROWS - 1));
+	crt_scrolled++;
+	crt_pos -= CRT_COLS;
+}
+
+// Like cga_putc on each byte, but plain characters go into the
+// shadow a line's worth at a time.
+static void
+cga_write(const char *buf, size_t n)
+{
+	size_t i, m;
+
+	while (n > 0) {
+		if ((uint8_t) *buf < ' ') {
+			cga_putc((uint8_t) *buf++);
+			n--;
+			continue;
+		}
+
+		m = MIN(n, (size_t) (CRT_COLS - crt_pos % CRT_COLS));
+		for (i = 0; i < m && (uint8_t) buf[i] >= ' '; i++)
+			crt_shadow[crt_pos + i] = cga_attr | (uint8_t) buf[i];
+		crt_dirty |= 1 << (crt_pos / CRT_COLS);
+		crt_pos += i;
+		buf += i;
+		n -= i;
+		if (crt_pos >= CRT_SIZE)
+			cga_scroll();
+	}
+}
+
+// Bring the display up to date with crt_shadow.
+static void
+cga_flush(void)
+{
+	uint32_t origin;
+	uint16_t cursor;
+	int i, j;
+
+	// Catch up on scrolling by moving the origin.  What the display
+	// shows then matches crt_shadow, but for the dirty lines.
+	if (crt_scrolled > 0) {
+		if (crt_scrolled > CRT_ROWS)
+			crt_scrolled = CRT_ROWS;
+		origin = crt_origin + crt_scrolled * CRT_COLS;
+		if (origin + CRT_SIZE > crt_cells) {
+			origin = 0;
+			crt_dirty = (1 << CRT_ROWS) - 1;
+		}
+		if (origin != crt_origin)
+			crt_set_origin(origin);
+		crt_scrolled = 0;
+	}
 
-		memmove(crt_buf, crt_buf + CRT_COLS, (CRT_SIZE - CRT_COLS) * sizeof(uint16_t));
-		for (i = CRT_SIZE - CRT_COLS; i < CRT_SIZE; i++)
-			crt_buf[i] = 0x0700 | ' ';
-		crt_pos -= CRT_COLS;
+	// copy each run of dirty lines at once
+	for (i = 0; crt_dirty != 0 && i < CRT_ROWS; i = j + 1) {
+		for (j = i; j < CRT_ROWS && (crt_dirty & (1 << j)); j++)
+			/* do nothing */;
+		if (j > i)
+			memmove(crt_buf + crt_origin + i * CRT_COLS,
+				crt_shadow + i * CRT_COLS,
+				(j - i) * CRT_COLS * sizeof(uint16_t));
 	}
+	crt_dirty = 0;
 
 	/* move that little blinky thing */
-	outb(addr_6845, 14);
-	outb(addr_6845 + 1, crt_pos >> 8);
-	outb(addr_6845, 15);
-	outb(addr_6845 + 1, crt_pos);
+	cursor = crt_origin + crt_pos;
+	if (cursor != crt_cursor) {
+		outb(addr_6845, 14);
+		outb(addr_6845 + 1, cursor >> 8);
+		outb(addr_6845, 15);
+		outb(addr_6845 + 1, cursor);
+		crt_cursor = cursor;
+	}
 }
 
 
@@ -428,34 +706,124 @@ cons_getc(void)
 	return 0;
 }
 
-// output a character to the console
+// The devices console output goes to.  cons_init probes each one, and
+// those that are present and enabled go into cons_active: output only
+// ever looks at that list, so absent or disabled devices cost nothing.
+static struct Conssink sinks[] = {
+	{ "serial", serial_init, serial_write, serial_tx_drain, serial_flush },
+	{ "lpt", lpt_init, lpt_write, NULL, NULL },
+	{ "debugcon", debugcon_init, debugcon_write, NULL, NULL },
+	{ "cga", cga_init, cga_write, cga_flush, NULL },
+};
+
+static struct Conssink *cons_active[ARRAY_SIZE(sinks)];
+static int cons_nactive;
+
 static void
-cons_putc(int c)
+cons_update_active(void)
+{
+	int i;
+
+	cons_nactive = 0;
+	for (i = 0; i < ARRAY_SIZE(sinks); i++)
+		if (sinks[i].present && sinks[i].enabled)
+			cons_active[cons_nactive++] = &sinks[i];
+}
+
+// Return the i'th console sink, or NULL if there are fewer.
+struct Conssink *
+cons_sink(int i)
+{
+	return (i >= 0 && i < ARRAY_SIZE(sinks)) ? &sinks[i] : NULL;
+}
+
+// Turn output to a sink on or off.  The last one stays on.
+int
+cons_sink_enable(struct Conssink *sink, bool enable)
 {
-	serial_putc(c);
-	lpt_putc(c);
-	cga_putc(c);
+	if (enable && !sink->present)
+		return -E_INVAL;
+	if (!enable && sink->enabled && cons_nactive == 1)
+		return -E_INVAL;
+	if (!enable && sink->enabled && sink->flush)
+		sink->flush();
+	sink->enabled = enable;
+	cons_update_active();
+	klog("cons: %s %s", sink->name, enable ? "on" : "off");
+	return 0;
+}
+
+// output 'n' bytes to the console; they show up on the screen at
+// the next cons_flush
+void
+cons_write(const char *buf, size_t n)
+{
+	int i;
+
+	for (i = 0; i < cons_nactive; i++)
+		cons_active[i]->write(buf, n);
 }
 
 // initialize the console devices
 void
 cons_init(void)
 {
-	cga_init();
+	int i;
+
 	kbd_init();
-	serial_init();
+	for (i = 0; i < ARRAY_SIZE(sinks); i++)
+		sinks[i].enabled = sinks[i].present = sinks[i].probe();
+	cons_update_active();
 
 	if (!serial_exists)
 		cprintf("Serial port does not exist!\n");
 }
 
+// make the output since the last flush visible, without waiting
+void
+cons_flush(void)
+{
+	int i;
+
+	for (i = 0; i < cons_nactive; i++)
+		if (cons_active[i]->flush)
+			cons_active[i]->flush();
+}
+
+// flush, and wait until buffered output has reached the devices
+void
+cons_sync(void)
+{
+	int i;
+
+	cons_flush();
+	for (i = 0; i < cons_nactive; i++)
+		if (cons_active[i]->sync)
+			cons_active[i]->sync();
+}
+
 
 // `High'-level console I/O.  Used by readline and cprintf.
 
+// Bits 8-15 of 'c', if any are set, are a CGA attribute (a color) for
+// the character; the other devices get only the low byte.
 void
 cputchar(int c)
 {
-	cons_putc(c);
+	char ch = c;
+
+	if (c & ~0xFF)
+		cga_attr = c & 0xFF00;
+	cputs(&ch, 1);
+	cga_attr = 0x0700;
+}
+
+// Write 'len' bytes to the console and show them.
+void
+cputs(const char *str, size_t len)
+{
+	cons_write(str, len);
+	cons_flush();
 }
 
 int
@@ -12,13 +12,47 @@
 #define MONO_BUF	0xB0000
 #define CGA_BASE	0x3D4
 #define CGA_BUF		0xB8000
+#define CGA_CELLS	(0x8000 / 2)	// 16-bit cells in the CGA buffer
 
 #define CRT_ROWS	25
 #define CRT_COLS	80
 #define CRT_SIZE	(CRT_ROWS * CRT_COLS)
 
+// Serial port speed; must divide 115200
+#ifndef COM_BAUD
+#define COM_BAUD	115200
+#endif
+
+// Serial port state and counters, for the kernel monitor
+struct Serialstat {
+	uint32_t ss_baud;
+	uint32_t ss_fifo;	// bytes sent per transmitter-empty event
+	uint32_t ss_txfull;	// times output found the ring buffer full
+	uint32_t ss_txdrop;	// bytes dropped: the transmitter was stuck
+	uint32_t ss_rxoverrun;	// receive overruns the UART reported
+};
+
+extern struct Serialstat serialstat;
+
+// A device that console output goes to (see kern/console.c)
+struct Conssink {
+	const char *name;
+	bool (*probe)(void);	// initialize; returns whether it is there
+	void (*write)(const char *buf, size_t n);
+	void (*flush)(void);	// show buffered output, or NULL
+	void (*sync)(void);	// wait until it is out, or NULL
+	bool present;
+	bool enabled;
+};
+
 void cons_init(void);
 int cons_getc(void);
+void cons_write(const char *buf, size_t n);
+void cons_flush(void);
+void cons_sync(void);
+
+struct Conssink *cons_sink(int i);
+int cons_sink_enable(struct Conssink *sink, bool enable);
 
 void kbd_intr(void); // irq 1
 void serial_intr(void); // irq 4
@@ -0,0 +1,73 @@
+// The CPU's features, from CPUID, in one table that the rest of the
+// kernel can consult instead of running CPUID itself.
+
+#include <inc/x86.h>
+#include <inc/mmu.h>
+#include <inc/string.h>
+
+#include <kern/cpu.h>
+
+char cpu_vendor[13];
+
+const char *const cpu_feature_names[NCPUFEAT] = {
+	[CPU_TSC]	= "tsc",
+	[CPU_INVTSC]	= "invtsc",
+	[CPU_PSE]	= "pse",
+	[CPU_PGE]	= "pge",
+	[CPU_FXSR]	= "fxsr",
+	[CPU_SSE2]	= "sse2",
+	[CPU_ERMS]	= "erms",
+};
+
+static uint32_t cpu_features;	// 1 << CPU_xxx for each feature found
+
+void
+cpu_init(void)
+{
+	uint32_t maxfn, maxxfn, ebx, ecx, edx;
+
+	cpuid(0, &maxfn, &ebx, &ecx, &edx);
+	memmove(cpu_vendor, &ebx, 4);
+	memmove(cpu_vendor + 4, &edx, 4);
+	memmove(cpu_vendor + 8, &ecx, 4);
+
+	cpuid(1, NULL, NULL, NULL, &edx);
+	if (edx & CPUID_TSC)
+		cpu_features |= 1 << CPU_TSC;
+	if (edx & CPUID_PSE)
+		cpu_features |= 1 << CPU_PSE;
+	if (edx & CPUID_PGE)
+		cpu_features |= 1 << CPU_PGE;
+	if (edx & CPUID_FXSR)
+		cpu_features |= 1 << CPU_FXSR;
+	if (edx & CPUID_SSE2)
+		cpu_features |= 1 << CPU_SSE2;
+
+	if (maxfn >= 7) {
+		cpuid(7, NULL, &ebx, NULL, NULL);
+		if (ebx & CPUID7_ERMS)
+			cpu_features |= 1 << CPU_ERMS;
+	}
+
+	cpuid(0x80000000, &maxxfn, NULL, NULL, NULL);
+	if (maxxfn >= 0x80000007) {
+		cpuid(0x80000007, NULL, NULL, NULL, &edx);
+		if (edx & CPUIDX_INVTSC)
+			cpu_features |= 1 << CPU_INVTSC;
+	}
+
+	// Let the kernel use SSE instructions: no x87 emulation, and
+	// no device-not-available fault on the first use.  Nothing
+	// saves the SSE registers yet, since only the kernel runs;
+	// switching to user environments will have to.
+	if (cpu_has(CPU_FXSR) && cpu_has(CPU_SSE2)) {
+		lcr0((rcr0() & ~(CR0_EM | CR0_TS)) | CR0_MP);
+		lcr4(rcr4() | CR4_OSFXSR | CR4_OSXMMEXCPT);
+	}
+}
+
+bool
+cpu_has(int feature)
+{
+	return (cpu_features & (1 << feature)) != 0;
+}
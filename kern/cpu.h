@@ -0,0 +1,27 @@
+#ifndef JOS_KERN_CPU_H
+#define JOS_KERN_CPU_H
+#ifndef JOS_KERNEL
+# error "This is a JOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+
+// CPU features the kernel looks for
+enum {
+	CPU_TSC = 0,	// time stamp counter
+	CPU_INVTSC,	// the TSC runs at a constant rate
+	CPU_PSE,	// 4MB pages
+	CPU_PGE,	// global pages
+	CPU_FXSR,	// FXSAVE/FXRSTOR
+	CPU_SSE2,	// SSE2 instructions
+	CPU_ERMS,	// fast REP MOVSB/STOSB
+	NCPUFEAT
+};
+
+extern char cpu_vendor[];
+extern const char *const cpu_feature_names[NCPUFEAT];
+
+void cpu_init(void);
+bool cpu_has(int feature);
+
+#endif	// !JOS_KERN_CPU_H
@@ -3,14 +3,24 @@
 #include <inc/stdio.h>
 #include <inc/string.h>
 #include <inc/assert.h>
+#include <inc/x86.h>
+#include <inc/memlayout.h>
+#include <inc/bootinfo.h>
 
 #include <kern/monitor.h>
 #include <kern/console.h>
+#include <kern/klog.h>
+#include <kern/cpu.h>
+#include <kern/kstring.h>
+
+// The kernel's copy of the boot loader's struct Bootinfo
+struct Bootinfo bootinfo;
 
 // Test the stack backtrace function (lab 1 only)
 void
 test_backtrace(int x)
 {
+	klog("test_backtrace %d", x);
 	cprintf("entering test_backtrace %d\n", x);
 	if (x > 0)
 		test_backtrace(x-1);
@@ -23,17 +33,31 @@ void
 i386_init(void)
 {
 	extern char edata[], end[];
+	struct Bootinfo *bi = (struct Bootinfo *) (KERNBASE + BOOTINFO_PA);
+	uint64_t init_tsc = read_tsc();
    	// Lab1 only
 	char chnum1 = 0, chnum2 = 0, ntest[256] = {};
 
 	// Before doing anything else, complete the ELF loading process.
 	// Clear the uninitialized global data (BSS) section of our program.
 	// This ensures that all static/global variables start out zero.
-	memset(edata, 0, end - edata);
+	// Our boot loader already did this if it says so in the boot info.
+	if (bi->bi_magic != BOOTINFO_MAGIC || !(bi->bi_flags & BI_BSS_CLEAR))
+		memset(edata, 0, end - edata);
+
+	// Keep the boot loader's information before low memory gets reused.
+	if (bi->bi_magic == BOOTINFO_MAGIC)
+		bootinfo = *bi;
+	bootinfo.bi_tsc[BT_INIT] = init_tsc;
+
+	// Find out what the CPU can do, and pick string routines to suit.
+	cpu_init();
+	kstring_init();
 
 	// Initialize the console.
 	// Can't call cprintf until after we do this!
 	cons_init();
+	bootinfo.bi_tsc[BT_CONS] = read_tsc();
 
 	cprintf("6828 decimal is %o octal!%n\n%n", 6828, &chnum1, &chnum2);
 	cprintf("pading space in the right to number 22: %-8d.\n", 22);
@@ -80,6 +104,7 @@ _panic(const char *file, int line, const char *fmt,...)
 	vcprintf(fmt, ap);
 	cprintf("\n");
 	va_end(ap);
+	cons_sync();
 
 dead:
 	/* break into the kernel monitor */
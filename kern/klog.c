@@ -0,0 +1,100 @@
+// Deferred kernel log.  klog() takes cprintf-style arguments but does
+// not format them: it only stores the format string pointer, the time
+// stamp counter and the raw argument words in a ring.  How many words
+// a format takes is counted once per call site (struct Klogsite).  The monitor's
+// "klog" command dumps the ring, and kern/klogdump.pl turns the dump
+// back into text by looking the pointers up in obj/kern/kernel.
+//
+// So the format string, and the string behind any %s, must be in the
+// kernel image, and must not change while the record is kept: string
+// constants are fine, buffers on the stack are not.
+
+#include <inc/stdio.h>
+#include <inc/stdarg.h>
+#include <inc/string.h>
+#include <inc/x86.h>
+
+#include <kern/klog.h>
+#include <kern/tsc.h>
+
+static struct Klogrec klog_ring[KLOG_NREC];
+static uint32_t klog_seq;	// records logged since boot
+
+// How many argument words the conversions in 'fmt' take: one for each
+// (and for each '*'), two for the long long ones.
+static int
+klog_nwords(const char *fmt)
+{
+	int n = 0, lflag;
+
+	while ((fmt = strchr(fmt, '%')) != NULL) {
+		lflag = 0;
+		for (fmt++; *fmt != '\0'; fmt++)
+			if (*fmt == '*')
+				n++;
+			else if (*fmt == 'l')
+				lflag++;
+			else if (!strchr("-+#.0123456789", *fmt))
+				break;
+		if (*fmt == '\0')
+			break;
+		if (*fmt++ != '%')
+			n += (lflag >= 2 ? 2 : 1);
+	}
+	return n;
+}
+
+// The klog() macro calls this with its call site's Klogsite.  The
+// count is redone only if the site passes a different format than
+// last time, which only a site whose format is not a constant can.
+void
+klog_site(struct Klogsite *site, const char *fmt, ...)
+{
+	struct Klogrec *r = &klog_ring[klog_seq++ % KLOG_NREC];
+	va_list ap;
+	int i;
+
+	r->kr_tsc = read_tsc();
+	if (site->ks_fmt != fmt) {
+		site->ks_nargs = MIN(klog_nwords(fmt), KLOG_NARGS);
+		site->ks_fmt = fmt;
+	}
+	r->kr_fmt = fmt;
+	r->kr_nargs = site->ks_nargs;
+	// On i386 every argument is pushed as one or more 32-bit words,
+	// so a long long comes out as two of them, low word first.
+	va_start(ap, fmt);
+	for (i = 0; i < r->kr_nargs; i++)
+		r->kr_args[i] = va_arg(ap, uint32_t);
+	va_end(ap);
+}
+
+// Print the records still in the ring, oldest first, one per line:
+//	klog <seq> <tsc> <fmt> <args>...
+// all in hex, after a line giving the record count, the first
+// sequence number and the TSC rate in kHz.  The lines go straight to
+// the console with cputs, not through cprintf: a full dump is bigger
+// than the message buffer and would push every boot message out.
+void
+klog_dump(void)
+{
+	struct Klogrec *r;
+	uint32_t seq, first;
+	char line[128];
+	int i, n;
+
+	first = klog_seq > KLOG_NREC ? klog_seq - KLOG_NREC : 0;
+	n = snprintf(line, sizeof(line), "klog %u %u %u\n",
+		     klog_seq - first, first, tsc_khz());
+	cputs(line, n);
+	for (seq = first; seq != klog_seq; seq++) {
+		r = &klog_ring[seq % KLOG_NREC];
+		n = snprintf(line, sizeof(line), "klog %08x %016llx %08x",
+			     seq, r->kr_tsc, r->kr_fmt);
+		for (i = 0; i < r->kr_nargs; i++)
+			n += snprintf(line + n, sizeof(line) - n, " %08x",
+				      r->kr_args[i]);
+		n += snprintf(line + n, sizeof(line) - n, "\n");
+		cputs(line, n);
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef JOS_KERN_KLOG_H
+#define JOS_KERN_KLOG_H
+#ifndef JOS_KERNEL
+# error "This is a JOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+
+#define KLOG_NREC	256		// records kept; a power of 2
+#define KLOG_NARGS	6		// argument words kept per record
+
+// One klog() call, not yet formatted
+struct Klogrec {
+	uint64_t kr_tsc;		// when it was logged
+	const char *kr_fmt;		// the format string, in the kernel image
+	uint32_t kr_nargs;		// words used in kr_args
+	uint32_t kr_args[KLOG_NARGS];	// the arguments, as pushed
+};
+
+// What klog() knows about one call site: how many argument words its
+// format takes, worked out on the first call, so that later calls
+// skip parsing the format.
+struct Klogsite {
+	const char *ks_fmt;		// the format ks_nargs was counted for
+	uint32_t ks_nargs;
+};
+
+// Log a message for kern/klogdump.pl to format later (see kern/klog.c)
+#define klog(...) do {							\
+		static struct Klogsite __klogsite;			\
+		klog_site(&__klogsite, __VA_ARGS__);			\
+	} while (0)
+
+void klog_site(struct Klogsite *site, const char *fmt, ...);
+void klog_dump(void);
+
+#endif	// !JOS_KERN_KLOG_H
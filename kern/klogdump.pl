@@ -0,0 +1,131 @@
+#!/usr/bin/perl
+
+# Decode the deferred kernel log (kern/klog.c).  Run the monitor's
+# "klog" command, capture what it prints (from the serial port, say),
+# and feed that to this script along with the kernel it came from:
+#
+#	usage: klogdump.pl obj/kern/kernel [console-output ...]
+#
+# Each record holds only pointers and raw argument words, so the
+# format strings, and the strings behind %s, are read from the
+# kernel's ELF file.  Times are seconds since the CPU was reset.
+
+use strict;
+use warnings;
+
+die "usage: klogdump.pl kernel [console-output ...]\n" unless @ARGV;
+my $kernel = shift(@ARGV);
+
+# The loadable segments of the kernel, as [vaddr, file offset, size].
+my ($elf, @segs);
+open(K, $kernel) || die "open $kernel: $!";
+binmode K;
+read(K, $elf, -s $kernel);
+close K;
+die "$kernel: not an ELF file\n" unless substr($elf, 0, 4) eq "\x7fELF";
+my ($phoff) = unpack("V", substr($elf, 28, 4));
+my ($phnum) = unpack("v", substr($elf, 44, 2));
+for (my $i = 0; $i < $phnum; $i++) {
+	my ($type, $off, $va, $pa, $filesz) =
+		unpack("V5", substr($elf, $phoff + 32 * $i, 20));
+	push(@segs, [$va, $off, $filesz]) if $type == 1;
+}
+
+# The NUL-terminated string at kernel address $va, or undef if it
+# is not in the file.
+sub kstring {
+	my ($va) = @_;
+
+	foreach my $s (@segs) {
+		my ($sva, $off, $size) = @$s;
+		next if $va < $sva || $va >= $sva + $size;
+		my $str = substr($elf, $off + $va - $sva, $sva + $size - $va);
+		$str =~ s/\0.*//s;
+		return $str;
+	}
+	return undef;
+}
+
+# As in lib/printfmt.c
+my %errors = (
+	1 => "unspecified error",
+	2 => "bad environment",
+	3 => "invalid parameter",
+	4 => "out of memory",
+	5 => "out of environments",
+	6 => "segmentation fault",
+);
+
+# Format one record the way vprintfmt would have.
+sub kformat {
+	my ($fmt, @args) = @_;
+	my $out = "";
+
+	while ($fmt =~ /\G([^%]*)%([-+#0]*)(\*|\d*)(?:\.(\*|\d*))?(l*)(.?)/gc) {
+		my ($text, $flags, $width, $prec, $l, $conv) =
+			($1, $2, $3, $4, $5, $6);
+		$out .= $text;
+		$width = shift(@args) // 0 if $width eq "*";
+		$prec = shift(@args) // 0 if defined($prec) && $prec eq "*";
+		my $spec = "%" . $flags . $width .
+			(defined($prec) ? ".$prec" : "");
+		my $v = 0;
+		if ($conv =~ /[doux]/) {
+			$v = shift(@args) // 0;
+			$v += (shift(@args) // 0) * 2**32 if length($l) >= 2;
+		}
+		if ($conv eq "d") {
+			$v -= 2**(length($l) >= 2 ? 64 : 32)
+				if $v >= 2**(length($l) >= 2 ? 63 : 31);
+			$out .= sprintf($spec . "d", $v);
+		} elsif ($conv eq "u" || $conv eq "x") {
+			$out .= sprintf($spec . $conv, $v);
+		} elsif ($conv eq "o") {
+			$out .= "0" . sprintf($spec . "o", $v);
+		} elsif ($conv eq "p") {
+			$out .= sprintf("0x" . $spec . "x", shift(@args) // 0);
+		} elsif ($conv eq "c") {
+			$out .= chr((shift(@args) // 0) & 0xFF);
+		} elsif ($conv eq "s") {
+			my $p = shift(@args) // 0;
+			my $s = $p ? kstring($p) : "(null)";
+			$s = sprintf("<%08x>", $p) unless defined $s;
+			$out .= sprintf($spec . "s", $s);
+		} elsif ($conv eq "e") {
+			my $e = abs(unpack("l", pack("L", shift(@args) // 0)));
+			$out .= $errors{$e} // "error $e";
+		} elsif ($conv eq "n") {
+			shift(@args);
+		} elsif ($conv eq "%") {
+			$out .= "%";
+		} else {
+			$out .= "%$flags$width" . (defined($prec) ? ".$prec" : "")
+				. "$l$conv";
+		}
+	}
+	$fmt =~ /\G(.*)/s;
+	return $out . $1;
+}
+
+my ($khz, $nrec) = (0, 0);
+while (<>) {
+	s/\r//g;
+	if (/^klog (\d+) (\d+) (\d+)$/) {
+		$khz = $3;
+	} elsif (/^klog ([0-9a-f]{8}) ([0-9a-f]{16}) ([0-9a-f]{8})((?: [0-9a-f]{8})*)$/) {
+		my ($tsc, $fmtp) = (hex($2), hex($3));
+		my @args = map { hex } split(" ", $4);
+		my $fmt = kstring($fmtp);
+		my $text = defined($fmt) ? kformat($fmt, @args)
+			: sprintf("<format %08x>%s", $fmtp,
+				  join("", map { sprintf(" %08x", $_) } @args));
+		$text =~ s/\n$//;
+		if ($khz) {
+			printf("[%12.6f] %s\n", $tsc / ($khz * 1000), $text);
+		} else {
+			printf("[%16x] %s\n", $tsc, $text);
+		}
+		$nrec++;
+	}
+}
+die "klogdump: no klog records found\n" unless $nrec;
@@ -0,0 +1,180 @@
+// Versions of memcpy, memset and memcmp for particular CPUs.
+// kstring_init picks the best ones the CPU has, going by the feature
+// table in kern/cpu.c, and points lib/string.c's memcpy_impl etc. at
+// them.  The generic versions in lib/string.c are the fallback.
+//
+// The kernel itself is compiled with -mno-sse (see GNUmakefile), so
+// the compiler never uses the XMM registers and they keep their
+// values from one asm statement to the next.  The SSE2 versions save
+// the ones they use first and put them back after, so that whoever
+// called memcpy is not left with different XMM registers.
+
+#include <inc/types.h>
+#include <inc/string.h>
+
+#include <kern/cpu.h>
+#include <kern/kstring.h>
+
+// Below this many bytes, the generic versions do as well
+#define KSTRING_MIN	64
+
+struct Kstringsel kstringsel = { "generic", "generic", "generic" };
+
+// Room for %xmm0 and %xmm1
+struct Xmmsave {
+	uint8_t xs_xmm[2][16];
+};
+
+static inline void
+xmm_save(struct Xmmsave *xs)
+{
+	asm volatile("movdqu %%xmm0, (%0)\n"
+		"movdqu %%xmm1, 16(%0)\n"
+		:: "r" (xs) : "memory");
+}
+
+static inline void
+xmm_restore(const struct Xmmsave *xs)
+{
+	asm volatile("movdqu (%0), %%xmm0\n"
+		"movdqu 16(%0), %%xmm1\n"
+		:: "r" (xs) : "memory");
+}
+
+// With enhanced REP MOVSB/STOSB, the byte string instructions are the
+// fastest way to copy and fill, whatever the alignment, once there is
+// enough to pay for their start-up time.
+static void *
+memcpy_erms(void *dst, const void *src, size_t n)
+{
+	void *d = dst;
+
+	if (n < KSTRING_MIN)
+		return memcpy_generic(dst, src, n);
+	asm volatile("cld; rep movsb\n"
+		: "+D" (d), "+S" (src), "+c" (n) :: "cc", "memory");
+	return dst;
+}
+
+static void *
+memset_erms(void *v, int c, size_t n)
+{
+	void *p = v;
+
+	if (n < KSTRING_MIN)
+		return memset_generic(v, c, n);
+	asm volatile("cld; rep stosb\n"
+		: "+D" (p), "+c" (n) : "a" (c) : "cc", "memory");
+	return v;
+}
+
+// The SSE2 versions do the first and last 16 bytes unaligned and
+// everything in between with aligned 16-byte stores.
+static void *
+memcpy_sse2(void *dst, const void *src, size_t n)
+{
+	char *d = dst, *end = d + n;
+	uintptr_t delta = (const char *) src - d;
+	struct Xmmsave xs;
+
+	if (n < KSTRING_MIN)
+		return memcpy_generic(dst, src, n);
+	xmm_save(&xs);
+	asm volatile("movdqu (%0,%2), %%xmm0\n"
+		"movdqu -16(%1,%2), %%xmm1\n"
+		"movdqu %%xmm0, (%0)\n"
+		"addl $16, %0\n"
+		"andl $-16, %0\n"
+		"subl $16, %1\n"
+		"1:\n"
+		"cmpl %1, %0\n"
+		"ja 2f\n"
+		"movdqu (%0,%2), %%xmm0\n"
+		"movdqa %%xmm0, (%0)\n"
+		"addl $16, %0\n"
+		"jmp 1b\n"
+		"2:\n"
+		"movdqu %%xmm1, (%1)\n"
+		: "+r" (d), "+r" (end) : "r" (delta) : "cc", "memory");
+	xmm_restore(&xs);
+	return dst;
+}
+
+static void *
+memset_sse2(void *v, int c, size_t n)
+{
+	char *p = v, *end = p + n;
+	struct Xmmsave xs;
+
+	if (n < KSTRING_MIN)
+		return memset_generic(v, c, n);
+	xmm_save(&xs);
+	asm volatile("movd %2, %%xmm0\n"
+		"pshufd $0, %%xmm0, %%xmm0\n"
+		"movdqu %%xmm0, (%0)\n"
+		"movdqu %%xmm0, -16(%1)\n"
+		"addl $16, %0\n"
+		"andl $-16, %0\n"
+		"subl $16, %1\n"
+		"1:\n"
+		"cmpl %1, %0\n"
+		"ja 2f\n"
+		"movdqa %%xmm0, (%0)\n"
+		"addl $16, %0\n"
+		"jmp 1b\n"
+		"2:\n"
+		: "+r" (p), "+r" (end) : "r" ((c & 0xFF) * 0x01010101)
+		: "cc", "memory");
+	xmm_restore(&xs);
+	return v;
+}
+
+// Compare 16 bytes at a time; the bytes that differ give a zero bit
+// in the mask.
+static int
+memcmp_sse2(const void *v1, const void *v2, size_t n)
+{
+	const uint8_t *s1 = v1, *s2 = v2;
+	struct Xmmsave xs;
+	uint32_t mask;
+	int i;
+
+	if (n < 16)
+		return memcmp_generic(s1, s2, n);
+	xmm_save(&xs);
+	for (; n >= 16; s1 += 16, s2 += 16, n -= 16) {
+		asm volatile("movdqu (%1), %%xmm0\n"
+			"movdqu (%2), %%xmm1\n"
+			"pcmpeqb %%xmm1, %%xmm0\n"
+			"pmovmskb %%xmm0, %0\n"
+			: "=r" (mask) : "r" (s1), "r" (s2) : "memory");
+		if (mask != 0xFFFF) {
+			xmm_restore(&xs);
+			i = __builtin_ctz(~mask);
+			return (int) s1[i] - (int) s2[i];
+		}
+	}
+	xmm_restore(&xs);
+	return memcmp_generic(s1, s2, n);
+}
+
+void
+kstring_init(void)
+{
+	// cpu_init turns SSE on only if the CPU has FXSAVE too
+	bool sse2 = cpu_has(CPU_SSE2) && cpu_has(CPU_FXSR);
+
+	if (cpu_has(CPU_ERMS)) {
+		memcpy_impl = memcpy_erms;
+		memset_impl = memset_erms;
+		kstringsel.ks_memcpy = kstringsel.ks_memset = "erms";
+	} else if (sse2) {
+		memcpy_impl = memcpy_sse2;
+		memset_impl = memset_sse2;
+		kstringsel.ks_memcpy = kstringsel.ks_memset = "sse2";
+	}
+	if (sse2) {
+		memcmp_impl = memcmp_sse2;
+		kstringsel.ks_memcmp = "sse2";
+	}
+}
@@ -0,0 +1,18 @@
+#ifndef JOS_KERN_KSTRING_H
+#define JOS_KERN_KSTRING_H
+#ifndef JOS_KERNEL
+# error "This is a JOS kernel header; user programs should not #include it"
+#endif
+
+// The versions of memcpy, memset and memcmp in use, by name
+struct Kstringsel {
+	const char *ks_memcpy;
+	const char *ks_memset;
+	const char *ks_memcmp;
+};
+
+extern struct Kstringsel kstringsel;
+
+void kstring_init(void);
+
+#endif	// !JOS_KERN_KSTRING_H
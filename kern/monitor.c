@@ -6,10 +6,18 @@
 #include <inc/memlayout.h>
 #include <inc/assert.h>
 #include <inc/x86.h>
+#include <inc/bootinfo.h>
 
 #include <kern/console.h>
 #include <kern/monitor.h>
 #include <kern/kdebug.h>
+#include <kern/tsc.h>
+#include <kern/tlb.h>
+#include <kern/reload.h>
+#include <kern/klog.h>
+#include <kern/msgbuf.h>
+#include <kern/cpu.h>
+#include <kern/kstring.h>
 
 #define CMDBUF_SIZE	80	// enough for one VGA text line
 
@@ -25,6 +33,14 @@ static struct Command commands[] = {
 	{ "help", "Display this list of commands", mon_help },
 	{ "kerninfo", "Display information about the kernel", mon_kerninfo },
 	{ "backtrace", "Display backtrace information about the function call", mon_backtrace },
+	{ "boottime", "Display how long each boot phase took", mon_boottime },
+	{ "tlb", "Display TLB flush counts; 'tlb reload [n]' times cr3 reloads", mon_tlb },
+	{ "reload", "Load and start the kernel again, skipping the BIOS", mon_reload },
+	{ "serial", "Display serial port settings and counters", mon_serial },
+	{ "cons", "List console output devices; 'cons <dev> on|off' to switch one", mon_cons },
+	{ "klog", "Dump the deferred log for kern/klogdump.pl to decode", mon_klog },
+	{ "dmesg", "Display kernel messages; 'dmesg -c' clears them after", mon_dmesg },
+	{ "cpu", "Display CPU features and the string routines picked for them", mon_cpu },
 };
 
 /***** Implementations of basic kernel monitor commands *****/
@@ -55,6 +71,171 @@ mon_kerninfo(int argc, char **argv, struct Trapframe *tf)
 	return 0;
 }
 
+int
+mon_boottime(int argc, char **argv, struct Trapframe *tf)
+{
+	extern struct Bootinfo bootinfo;
+	// the phase that ends at each time stamp
+	const char *phases[BT_NPHASE] = {
+		[BT_BOOT1]  = "BIOS",
+		[BT_BOOT2]  = "boot loader stage 1",
+		[BT_LOADED] = "boot loader stage 2 (kernel load)",
+		[BT_ENTRY]  = "jump to kernel",
+		[BT_INIT]   = "entry.S",
+		[BT_CONS]   = "cons_init",
+	};
+	uint64_t prev, t;
+	int i;
+
+	if (bootinfo.bi_magic != BOOTINFO_MAGIC) {
+		cprintf("No boot times: not started by the JOS boot loader\n");
+		return 0;
+	}
+
+	// After a reload, the first two phases are the previous kernel
+	// and its re-reading of stage 2 (see kern/reload.c).
+	if (bootinfo.bi_flags & BI_WARM) {
+		phases[BT_BOOT1] = "previous kernel, until reload";
+		phases[BT_BOOT2] = "reload of boot loader stage 2";
+	}
+
+	// The TSC starts from 0 at reset, so the BIOS phase starts there.
+	cprintf("TSC frequency %u kHz, kernel read by %s\n", tsc_khz(),
+		(bootinfo.bi_flags & BI_DISK_DMA) ? "DMA" : "PIO");
+	prev = 0;
+	for (i = 0; i < BT_NPHASE; i++) {
+		t = bootinfo.bi_tsc[i];
+		if (t < prev) {
+			cprintf("%12s        %10s us  %s\n", "-", "-", phases[i]);
+			continue;
+		}
+		cprintf("%12llu cycles %10llu us  %s\n",
+			t - prev, tsc_to_us(t - prev), phases[i]);
+		prev = t;
+	}
+	cprintf("%12llu cycles %10llu us  total\n", prev, tsc_to_us(prev));
+	return 0;
+}
+
+int
+mon_tlb(int argc, char **argv, struct Trapframe *tf)
+{
+	extern char entry[], end[];
+	volatile char *p;
+	uint64_t t;
+	int i, n;
+
+	cprintf("Global kernel pages: %s\n", tlb_global() ? "on" : "off");
+	if (argc > 1 && strcmp(argv[1], "reload") == 0) {
+		n = argc > 2 ? strtol(argv[2], NULL, 0) : 1000;
+		if (n <= 0)
+			n = 1;
+		// Each reload is followed by touching every page of the
+		// kernel, as returning to the kernel after a switch would:
+		// with global pages these touches still hit in the TLB.
+		t = read_tsc();
+		for (i = 0; i < n; i++) {
+			tlb_load_pgdir(rcr3());
+			for (p = entry; p < end; p += PGSIZE)
+				(void) *p;
+		}
+		t = read_tsc() - t;
+		cprintf("%d reloads: %llu cycles each, including TLB refills\n",
+			n, t / n);
+	}
+	cprintf("TLB flushes: %u cr3 reloads, %u full, %u single pages\n",
+		tlbstat.ts_reload, tlbstat.ts_flushall, tlbstat.ts_invlpg);
+	return 0;
+}
+
+int
+mon_reload(int argc, char **argv, struct Trapframe *tf)
+{
+	int r;
+
+	cprintf("Reloading the kernel from disk...\n");
+	cons_sync();
+	r = reload();
+	cprintf("reload: %e\n", r);
+	return 0;
+}
+
+int
+mon_serial(int argc, char **argv, struct Trapframe *tf)
+{
+	cprintf("COM1: %u baud, %u-byte transmit bursts\n",
+		serialstat.ss_baud, serialstat.ss_fifo);
+	cprintf("  output waited for a full buffer %u times, dropped %u bytes\n",
+		serialstat.ss_txfull, serialstat.ss_txdrop);
+	cprintf("  receive overruns %u\n", serialstat.ss_rxoverrun);
+	return 0;
+}
+
+int
+mon_cons(int argc, char **argv, struct Trapframe *tf)
+{
+	struct Conssink *sink;
+	int i;
+
+	if (argc == 1) {
+		for (i = 0; (sink = cons_sink(i)) != NULL; i++)
+			cprintf("  %s: %s\n", sink->name,
+				!sink->present ? "not present"
+				: sink->enabled ? "on" : "off");
+		return 0;
+	}
+
+	if (argc != 3 || (strcmp(argv[2], "on") != 0
+			  && strcmp(argv[2], "off") != 0)) {
+		cprintf("usage: cons [<dev> on|off]\n");
+		return 0;
+	}
+	for (i = 0; (sink = cons_sink(i)) != NULL; i++)
+		if (strcmp(sink->name, argv[1]) == 0)
+			break;
+	if (sink == NULL)
+		cprintf("cons: no device '%s'\n", argv[1]);
+	else if (cons_sink_enable(sink, strcmp(argv[2], "on") == 0) < 0)
+		cprintf("cons: %s\n", sink->present ? "need at least one device"
+			: "device not present");
+	return 0;
+}
+
+int
+mon_klog(int argc, char **argv, struct Trapframe *tf)
+{
+	klog_dump();
+	return 0;
+}
+
+int
+mon_dmesg(int argc, char **argv, struct Trapframe *tf)
+{
+	if (argc > 2 || (argc == 2 && strcmp(argv[1], "-c") != 0)) {
+		cprintf("usage: dmesg [-c]\n");
+		return 0;
+	}
+	msgbuf_print();
+	if (argc == 2)
+		msgbuf_clear();
+	return 0;
+}
+
+int
+mon_cpu(int argc, char **argv, struct Trapframe *tf)
+{
+	int i;
+
+	cprintf("CPU vendor: %s\n", cpu_vendor);
+	cprintf("Features:");
+	for (i = 0; i < NCPUFEAT; i++)
+		cprintf(" %s%s", cpu_has(i) ? "" : "-", cpu_feature_names[i]);
+	cprintf("\n");
+	cprintf("memcpy: %s  memset: %s  memcmp: %s\n", kstringsel.ks_memcpy,
+		kstringsel.ks_memset, kstringsel.ks_memcmp);
+	return 0;
+}
+
 // Lab1 only
 // read the pointer to the retaddr on the stack
 static uint32_t
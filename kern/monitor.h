@@ -15,5 +15,13 @@ void monitor(struct Trapframe *tf);
 int mon_help(int argc, char **argv, struct Trapframe *tf);
 int mon_kerninfo(int argc, char **argv, struct Trapframe *tf);
 int mon_backtrace(int argc, char **argv, struct Trapframe *tf);
+int mon_boottime(int argc, char **argv, struct Trapframe *tf);
+int mon_tlb(int argc, char **argv, struct Trapframe *tf);
+int mon_reload(int argc, char **argv, struct Trapframe *tf);
+int mon_serial(int argc, char **argv, struct Trapframe *tf);
+int mon_cons(int argc, char **argv, struct Trapframe *tf);
+int mon_klog(int argc, char **argv, struct Trapframe *tf);
+int mon_dmesg(int argc, char **argv, struct Trapframe *tf);
+int mon_cpu(int argc, char **argv, struct Trapframe *tf);
 
 #endif	// !JOS_KERN_MONITOR_H
@@ -0,0 +1,56 @@
+// The kernel message buffer: the last MSGBUF_SIZE bytes that cprintf
+// printed, kept in memory whether or not any console device showed
+// them, for the monitor's "dmesg" command.  When it is full, the
+// oldest messages are overwritten.
+
+#include <inc/stdio.h>
+#include <inc/string.h>
+
+#include <kern/msgbuf.h>
+
+static char msgbuf[MSGBUF_SIZE];
+static uint32_t msgbuf_end;	// bytes appended since boot
+static uint32_t msgbuf_start;	// where the last msgbuf_clear left off
+
+// Append 'n' bytes.  This is on every cprintf's path, so it is
+// only a copy or two.
+void
+msgbuf_append(const char *s, size_t n)
+{
+	uint32_t off, m;
+
+	if (n > MSGBUF_SIZE) {
+		msgbuf_end += n - MSGBUF_SIZE;
+		s += n - MSGBUF_SIZE;
+		n = MSGBUF_SIZE;
+	}
+	off = msgbuf_end % MSGBUF_SIZE;
+	m = MIN(n, MSGBUF_SIZE - off);
+	memmove(msgbuf + off, s, m);
+	memmove(msgbuf, s + m, n - m);
+	msgbuf_end += n;
+}
+
+// Print the messages kept since the last msgbuf_clear, oldest first.
+// They go straight to the console, so they are not appended again.
+void
+msgbuf_print(void)
+{
+	uint32_t start, off, n;
+
+	start = msgbuf_start;
+	if (msgbuf_end - start > MSGBUF_SIZE)
+		start = msgbuf_end - MSGBUF_SIZE;
+	off = start % MSGBUF_SIZE;
+	n = msgbuf_end - start;
+	cputs(msgbuf + off, MIN(n, MSGBUF_SIZE - off));
+	if (n > MSGBUF_SIZE - off)
+		cputs(msgbuf, n - (MSGBUF_SIZE - off));
+}
+
+// Forget the messages kept so far.
+void
+msgbuf_clear(void)
+{
+	msgbuf_start = msgbuf_end;
+}
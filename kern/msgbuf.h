@@ -0,0 +1,15 @@
+#ifndef JOS_KERN_MSGBUF_H
+#define JOS_KERN_MSGBUF_H
+#ifndef JOS_KERNEL
+# error "This is a JOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+
+#define MSGBUF_SIZE	16384		// bytes of messages kept; a power of 2
+
+void msgbuf_append(const char *s, size_t n);
+void msgbuf_print(void);
+void msgbuf_clear(void);
+
+#endif	// !JOS_KERN_MSGBUF_H
@@ -1,25 +1,74 @@
 // Simple implementation of cprintf console output for the kernel,
-// based on printfmt() and the kernel console's cputchar().
+// based on printfmt() and the kernel console's cons_write().
+// Output is collected in a buffer so that the console gets it in
+// a few large writes rather than one character at a time.
+// Everything printed is also kept in the message buffer.
 
 #include <inc/types.h>
 #include <inc/stdio.h>
 #include <inc/stdarg.h>
+#include <inc/string.h>
 
+#include <kern/console.h>
+#include <kern/msgbuf.h>
+
+
+struct printbuf {
+	int idx;	// current buffer index
+	int cnt;	// total bytes printed so far
+	char buf[256];
+};
+
+
+// Hand 'n' bytes of output to the message buffer and the console
+// devices.  The devices show it at the cons_flush in vcprintf.
+static void
+printout(const char *s, size_t n)
+{
+	msgbuf_append(s, n);
+	cons_write(s, n);
+}
 
 static void
-putch(int ch, int *cnt)
+putch(int ch, struct printbuf *b)
 {
-	cputchar(ch);
-	(*cnt)++;
+	b->buf[b->idx++] = ch;
+	if (b->idx == sizeof(b->buf)) {
+		printout(b->buf, b->idx);
+		b->idx = 0;
+	}
+	b->cnt++;
+}
+
+// Spans from vprintfmt_write; ones as big as the buffer bypass it.
+static void
+putspan(const char *s, size_t n, struct printbuf *b)
+{
+	if (n > sizeof(b->buf) - b->idx) {
+		printout(b->buf, b->idx);
+		b->idx = 0;
+	}
+	if (n >= sizeof(b->buf))
+		printout(s, n);
+	else {
+		memmove(b->buf + b->idx, s, n);
+		b->idx += n;
+	}
+	b->cnt += n;
 }
 
 int
 vcprintf(const char *fmt, va_list ap)
 {
-	int cnt = 0;
+	struct printbuf b;
 
-	vprintfmt((void*)putch, &cnt, fmt, ap);
-	return cnt;
+	b.idx = 0;
+	b.cnt = 0;
+	vprintfmt_write((void*)putch, (void*)putspan, &b, fmt, ap);
+	printout(b.buf, b.idx);
+	cons_flush();
+
+	return b.cnt;
 }
 
 int
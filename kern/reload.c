@@ -0,0 +1,77 @@
+// Warm reload: start a fresh kernel from the boot disk without going
+// through the BIOS, by running the second stage of the boot loader
+// again, just as stage 1 would have.
+
+#include <inc/x86.h>
+#include <inc/mmu.h>
+#include <inc/memlayout.h>
+#include <inc/error.h>
+#include <inc/bootinfo.h>
+#include <boot/boot.h>
+
+#include <kern/reload.h>
+
+// entry.S: turn paging off and jump to a physical address
+void reload_trampoline(uint32_t entry) __attribute__((noreturn));
+
+// Read the second stage of the boot loader, which follows the MBR on
+// the disk, to BOOT2_ADDR.
+static int
+read_boot2(void)
+{
+	uint8_t *dst = (uint8_t *) (KERNBASE + BOOT2_ADDR);
+	int i;
+
+	ide_wait_ready(0);
+	outb(0x1F2, BOOT2_NSECT);
+	outb(0x1F3, 1);
+	outb(0x1F4, 0);
+	outb(0x1F5, 0);
+	outb(0x1F6, 0xE0);
+	outb(0x1F7, 0x20);	// READ SECTORS
+
+	for (i = 0; i < BOOT2_NSECT; i++, dst += SECTSIZE) {
+		if (ide_wait_ready(1) < 0)
+			return -E_FAULT;
+		insl(0x1F0, dst, SECTSIZE / 4);
+	}
+	return 0;
+}
+
+// Reload the kernel.  Returns only if that cannot be done, with
+// an error code.
+int
+reload(void)
+{
+	extern pde_t entry_pgdir[];
+	struct Boot2hdr *hdr = (struct Boot2hdr *) (KERNBASE + BOOT2_ADDR);
+	struct Bootinfo *bi = (struct Bootinfo *) (KERNBASE + BOOTINFO_PA);
+	void (*tramp)(uint32_t) __attribute__((noreturn));
+	uint32_t *p, sum;
+	int r;
+
+	// The trampoline runs at its physical address, through the
+	// identity mapping that only entry_pgdir has.
+	if (rcr3() != (uintptr_t) entry_pgdir - KERNBASE)
+		return -E_INVAL;
+
+	if ((r = read_boot2()) < 0)
+		return r;
+
+	// the same checks as stage 1 (boot/main.c)
+	if (hdr->b2_magic != BOOT2_MAGIC)
+		return -E_INVAL;
+	sum = 0;
+	for (p = (uint32_t *) hdr;
+	     p < (uint32_t *) ((uint8_t *) hdr + BOOT2_NSECT * SECTSIZE); p++)
+		sum += *p;
+	if (sum != 0)
+		return -E_INVAL;
+
+	// Stage 2 sees the warm boot flag that entry.S set and
+	// the stage 1 time stamp that we leave it.
+	asm volatile("cli");
+	bi->bi_tsc[BT_BOOT1] = read_tsc();
+	tramp = (void *) ((uintptr_t) reload_trampoline - KERNBASE);
+	tramp(hdr->b2_entry);
+}
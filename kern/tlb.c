@@ -0,0 +1,53 @@
+// TLB maintenance.  Every flush goes through here and is counted, so
+// that the cost of switching address spaces can be watched from the
+// kernel monitor.
+
+#include <inc/x86.h>
+#include <inc/mmu.h>
+
+#include <kern/tlb.h>
+
+struct Tlbstat tlbstat;
+
+// Whether kernel mappings are global (PTE_G) and survive cr3 loads.
+// entry.S turns on CR4_PGE when the CPU has global pages.
+bool
+tlb_global(void)
+{
+	return (rcr4() & CR4_PGE) != 0;
+}
+
+// Switch to the page directory at physical address 'pgdir'.  This
+// flushes every TLB entry that is not global, even if 'pgdir' is the
+// current page directory.
+void
+tlb_load_pgdir(physaddr_t pgdir)
+{
+	tlbstat.ts_reload++;
+	lcr3(pgdir);
+}
+
+// Flush the whole TLB, global entries included: needed after changing
+// a global mapping.
+void
+tlb_flush_all(void)
+{
+	uint32_t cr4;
+
+	tlbstat.ts_flushall++;
+	cr4 = rcr4();
+	if (cr4 & CR4_PGE) {
+		// toggling CR4_PGE flushes everything
+		lcr4(cr4 & ~CR4_PGE);
+		lcr4(cr4);
+	} else
+		lcr3(rcr3());
+}
+
+// Invalidate the TLB entry for 'va', global or not.
+void
+tlb_invalidate_va(void *va)
+{
+	tlbstat.ts_invlpg++;
+	invlpg(va);
+}
@@ -0,0 +1,23 @@
+#ifndef JOS_KERN_TLB_H
+#define JOS_KERN_TLB_H
+#ifndef JOS_KERNEL
+# error "This is a JOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+
+// How often each kind of TLB flush happened
+struct Tlbstat {
+	uint32_t ts_reload;	// cr3 loads: flush all but global entries
+	uint32_t ts_flushall;	// flushes of global entries too
+	uint32_t ts_invlpg;	// single-page invalidations
+};
+
+extern struct Tlbstat tlbstat;
+
+bool tlb_global(void);
+void tlb_load_pgdir(physaddr_t pgdir);
+void tlb_flush_all(void);
+void tlb_invalidate_va(void *va);
+
+#endif	// !JOS_KERN_TLB_H
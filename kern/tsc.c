@@ -0,0 +1,51 @@
+// Time stamp counter calibration against the 8253/8254 PIT.
+
+#include <inc/x86.h>
+
+#include <kern/tsc.h>
+
+#define PIT_HZ		1193182
+#define PIT_CH2		0x42		// channel 2 data port
+#define PIT_CMD		0x43		// mode/command port
+#define PIT_GATE	0x61		// channel 2 gate and output
+
+#define CAL_MS		10		// calibration window
+
+static uint32_t khz;
+
+// Count TSC cycles while PIT channel 2 counts down CAL_MS milliseconds
+// in one-shot mode.  Channel 2 is the speaker timer, so this needs no
+// interrupts; the speaker itself stays off.
+static uint32_t
+tsc_calibrate(void)
+{
+	uint32_t latch = PIT_HZ / (1000 / CAL_MS);
+	uint64_t t0, t1;
+
+	outb(PIT_GATE, (inb(PIT_GATE) & ~0x02) | 0x01);
+	outb(PIT_CMD, 0xB0);		// channel 2, lo/hi byte, mode 0
+	outb(PIT_CH2, latch & 0xFF);
+	outb(PIT_CH2, latch >> 8);
+
+	t0 = read_tsc();
+	while (!(inb(PIT_GATE) & 0x20))
+		/* do nothing */;
+	t1 = read_tsc();
+
+	return (t1 - t0) / CAL_MS;
+}
+
+// Return the TSC frequency in kHz, calibrating it on first use.
+uint32_t
+tsc_khz(void)
+{
+	if (khz == 0)
+		khz = tsc_calibrate();
+	return khz;
+}
+
+uint64_t
+tsc_to_us(uint64_t cycles)
+{
+	return cycles * 1000 / tsc_khz();
+}
@@ -0,0 +1,12 @@
+#ifndef JOS_KERN_TSC_H
+#define JOS_KERN_TSC_H
+#ifndef JOS_KERNEL
+# error "This is a JOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+
+uint32_t tsc_khz(void);
+uint64_t tsc_to_us(uint64_t cycles);
+
+#endif	// !JOS_KERN_TSC_H
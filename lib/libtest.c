@@ -0,0 +1,676 @@
+// Tests and benchmarks for lib/, run on the build host ("make libtest").
+// Each routine is checked against, and timed against, the simple
+// byte-at-a-time version it replaced.
+//
+// This file is built against JOS's headers and includes the lib/
+// sources themselves, so their static helpers can be reached.
+// lib/libtesthost.c supplies what needs the host's C library; the
+// output goes through the host's printf.
+
+#include <inc/types.h>
+#include <inc/stdio.h>
+#include <inc/stdarg.h>
+#include <inc/string.h>
+
+#include "string.c"
+#include "printfmt.c"
+
+// lib/libtesthost.c
+unsigned long long host_nsec(void);
+char *host_guard(int n);
+
+static int nfail;
+static volatile int sink;
+
+static void
+fail(const char *what, int align, int len, int pos)
+{
+	if (nfail++ < 20)
+		printf("FAIL %s: align %d, len %d, pos %d\n",
+		       what, align, len, pos);
+}
+
+
+// The versions the word-at-a-time ones replaced.
+
+static int
+old_strlen(const char *s)
+{
+	int n;
+
+	for (n = 0; *s != '\0'; s++)
+		n++;
+	return n;
+}
+
+static int
+old_strnlen(const char *s, size_t size)
+{
+	int n;
+
+	for (n = 0; size > 0 && *s != '\0'; s++, size--)
+		n++;
+	return n;
+}
+
+static int
+old_strcmp(const char *p, const char *q)
+{
+	while (*p && *p == *q)
+		p++, q++;
+	return (int) ((unsigned char) *p - (unsigned char) *q);
+}
+
+static char *
+old_strchr(const char *s, char c)
+{
+	for (; *s; s++)
+		if (*s == c)
+			return (char *) s;
+	return 0;
+}
+
+static char *
+old_strfind(const char *s, char c)
+{
+	for (; *s; s++)
+		if (*s == c)
+			break;
+	return (char *) s;
+}
+
+static int
+old_memcmp(const void *v1, const void *v2, size_t n)
+{
+	const uint8_t *s1 = (const uint8_t *) v1;
+	const uint8_t *s2 = (const uint8_t *) v2;
+
+	while (n-- > 0) {
+		if (*s1 != *s2)
+			return (int) *s1 - (int) *s2;
+		s1++, s2++;
+	}
+
+	return 0;
+}
+
+static void *
+old_memfind(const void *s, int c, size_t n)
+{
+	const void *ends = (const char *) s + n;
+	for (; s < ends; s++)
+		if (*(const unsigned char *) s == (unsigned char) c)
+			break;
+	return (void *) s;
+}
+
+// The old memset and memmove (which memcpy called) used rep stosl or
+// movsl only when the pointers and length were all multiples of 4.
+// The registers the rep instructions change are outputs here, which
+// they were not before; the instructions are the same.
+static void *
+old_memset(void *v, int c, size_t n)
+{
+	void *p = v;
+
+	if (n == 0)
+		return v;
+	if ((uintptr_t) v % 4 == 0 && n % 4 == 0) {
+		c &= 0xFF;
+		c = (c<<24)|(c<<16)|(c<<8)|c;
+		n /= 4;
+		asm volatile("cld; rep stosl\n"
+			: "+D" (p), "+c" (n) : "a" (c) : "cc", "memory");
+	} else
+		asm volatile("cld; rep stosb\n"
+			: "+D" (p), "+c" (n) : "a" (c) : "cc", "memory");
+	return v;
+}
+
+static void *
+old_memmove(void *dst, const void *src, size_t n)
+{
+	const char *s;
+	char *d;
+
+	s = src;
+	d = dst;
+	if (s < d && s + n > d) {
+		s += n - 1;
+		d += n - 1;
+		if ((uintptr_t) s % 4 == 3 && (uintptr_t) d % 4 == 3
+		    && n % 4 == 0) {
+			s -= 3, d -= 3, n /= 4;
+			asm volatile("std; rep movsl\n"
+				: "+D" (d), "+S" (s), "+c" (n) :: "cc", "memory");
+		} else
+			asm volatile("std; rep movsb\n"
+				: "+D" (d), "+S" (s), "+c" (n) :: "cc", "memory");
+		// Some versions of GCC rely on DF being clear
+		asm volatile("cld" ::: "cc");
+	} else {
+		if ((uintptr_t) s % 4 == 0 && (uintptr_t) d % 4 == 0
+		    && n % 4 == 0) {
+			n /= 4;
+			asm volatile("cld; rep movsl\n"
+				: "+D" (d), "+S" (s), "+c" (n) :: "cc", "memory");
+		} else
+			asm volatile("cld; rep movsb\n"
+				: "+D" (d), "+S" (s), "+c" (n) :: "cc", "memory");
+	}
+	return dst;
+}
+
+// printnum's digits, as it made them before fmtdigits
+static char *
+old_digits(char *p, unsigned long long num, unsigned base)
+{
+	do {
+		*--p = "0123456789abcdef"[num % base];
+		num /= base;
+	} while (num);
+	return p;
+}
+
+
+// Strings of up to MAXLEN bytes are tried at every alignment.
+#define MAXLEN		72
+#define NALIGN		8
+// Never in a string that mkstr makes
+#define ABSENT		((char) 0xFE)
+
+static char sbuf1[MAXLEN + NALIGN + 1] __attribute__((aligned(8)));
+static char sbuf2[MAXLEN + NALIGN + 1] __attribute__((aligned(8)));
+
+// Fill s with len non-null bytes, covering most byte values, and a null.
+static void
+mkstr(char *s, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		s[i] = 1 + (i * 37 + len) % 253;
+	s[len] = '\0';
+}
+
+// Check the string routines on the string s of length len.
+static void
+checkstr(const char *s, int align, int len)
+{
+	char *t = (char *) s;
+	char c;
+	int pos, size;
+
+	if (strlen(s) != old_strlen(s))
+		fail("strlen", align, len, -1);
+	for (size = 0; size <= len + 5; size++)
+		if (strnlen(s, size) != old_strnlen(s, size))
+			fail("strnlen", align, len, size);
+	if (strnlen(s, ~0) != len)
+		fail("strnlen", align, len, -1);
+
+	// Every character that is there, one that is not, and the null
+	for (pos = 0; pos <= len; pos++) {
+		c = s[pos];
+		if (strfind(s, c) != old_strfind(s, c))
+			fail("strfind", align, len, pos);
+		if (strchr(s, c) != old_strchr(s, c))
+			fail("strchr", align, len, pos);
+	}
+	if (strfind(s, ABSENT) != s + len || strchr(s, ABSENT) != NULL)
+		fail("strfind absent", align, len, -1);
+
+	// A character planted at each position, found before any later one
+	for (pos = 0; pos < len; pos++) {
+		c = t[pos];
+		t[pos] = ABSENT;
+		if (strfind(s, ABSENT) != s + pos
+		    || strchr(s, ABSENT) != s + pos)
+			fail("strfind planted", align, len, pos);
+		t[pos] = c;
+	}
+}
+
+// Compare s1 against s2, a copy of it at another alignment, as the
+// copy is changed or cut short at each position in turn.
+static void
+checkcmp(char *s1, char *s2, int align, int len)
+{
+	char c;
+	int pos;
+
+	if (strcmp(s1, s2) != 0 || strcmp(s2, s1) != 0)
+		fail("strcmp equal", align, len, -1);
+	for (pos = 0; pos < len; pos++) {
+		c = s2[pos];
+		s2[pos] = c + 1 ? c + 1 : c - 1;
+		if (strcmp(s1, s2) != old_strcmp(s1, s2)
+		    || strcmp(s2, s1) != old_strcmp(s2, s1))
+			fail("strcmp differ", align, len, pos);
+		s2[pos] = '\0';
+		if (strcmp(s1, s2) != old_strcmp(s1, s2)
+		    || strcmp(s2, s1) != old_strcmp(s2, s1))
+			fail("strcmp shorter", align, len, pos);
+		s2[pos] = c;
+	}
+}
+
+static void
+test_strings(void)
+{
+	char *g1, *g2, *s1, *s2;
+	int a1, a2, len;
+
+	for (a1 = 0; a1 < NALIGN; a1++)
+		for (len = 0; len <= MAXLEN; len++) {
+			s1 = sbuf1 + a1;
+			mkstr(s1, len);
+			checkstr(s1, a1, len);
+			for (a2 = 0; a2 < NALIGN; a2++) {
+				s2 = sbuf2 + a2;
+				mkstr(s2, len);
+				checkcmp(s1, s2, a1 * NALIGN + a2, len);
+			}
+		}
+
+	// Strings whose null is the last byte before an unmapped page:
+	// a word-at-a-time scan must not read past the word it is in.
+	g1 = host_guard(MAXLEN + 1);
+	g2 = host_guard(MAXLEN + 1);
+	for (len = 0; len <= MAXLEN; len++) {
+		s1 = g1 + MAXLEN - len;
+		s2 = g2 + MAXLEN - len;
+		mkstr(s1, len);
+		mkstr(s2, len);
+		checkstr(s1, -1, len);
+		checkcmp(s1, s2, -1, len);
+		mkstr(sbuf2 + len % NALIGN, len);
+		checkcmp(s1, sbuf2 + len % NALIGN, -1, len);
+	}
+}
+
+// Compare the len bytes at s1 and s2, equal to start with, as s2 is
+// changed at each position in turn, and look for bytes in s1.
+static void
+checkmem(char *s1, char *s2, int align, int len)
+{
+	char c;
+	int pos;
+
+	if (memcmp(s1, s2, len) != 0)
+		fail("memcmp equal", align, len, -1);
+	for (pos = 0; pos < len; pos++) {
+		c = s2[pos];
+		s2[pos] = c + 1;
+		if (memcmp(s1, s2, len) != old_memcmp(s1, s2, len)
+		    || memcmp(s2, s1, len) != old_memcmp(s2, s1, len))
+			fail("memcmp differ", align, len, pos);
+		if (memcmp(s1, s2, pos) != 0)
+			fail("memcmp prefix", align, len, pos);
+		s2[pos] = c;
+	}
+
+	for (pos = 0; pos < len; pos++)
+		if (memfind(s1, s1[pos], len) != old_memfind(s1, s1[pos], len))
+			fail("memfind", align, len, pos);
+	if (memfind(s1, ABSENT, len) != s1 + len)
+		fail("memfind absent", align, len, -1);
+	// Not found past the end, even if it is there
+	if (memfind(s1, s1[len], len) != old_memfind(s1, s1[len], len))
+		fail("memfind end", align, len, -1);
+}
+
+static void
+test_mem(void)
+{
+	char *g1, *g2, *s1, *s2;
+	int a1, a2, len;
+
+	for (a1 = 0; a1 < NALIGN; a1++)
+		for (len = 0; len <= MAXLEN; len++) {
+			s1 = sbuf1 + a1;
+			mkstr(s1, len);
+			s1[len] = 'x';
+			for (a2 = 0; a2 < NALIGN; a2++) {
+				s2 = sbuf2 + a2;
+				mkstr(s2, len);
+				checkmem(s1, s2, a1 * NALIGN + a2, len);
+			}
+		}
+
+	// Buffers that end where an unmapped page begins
+	g1 = host_guard(MAXLEN);
+	g2 = host_guard(MAXLEN);
+	for (len = 0; len < MAXLEN; len++) {
+		s1 = g1 + MAXLEN - len;
+		s2 = g2 + MAXLEN - len;
+		mkstr(sbuf1, len);
+		memmove(s1, sbuf1, len);
+		memmove(s2, sbuf1, len);
+		for (a1 = 0; a1 < len; a1++)
+			if (memcmp(s1, s2, len) != 0
+			    || memfind(s1, s1[a1], len) != old_memfind(s1, s1[a1], len)
+			    || memfind(s1, ABSENT, len) != s1 + len)
+				fail("mem guard", -1, len, a1);
+	}
+}
+
+// Copies and fills are tried at every alignment, at sizes up to and
+// past MEMALIGN_MIN, where they start aligning the middle.
+#define MAXCOPY		(2 * MEMALIGN_MIN + 9)
+#define COPYBUF		(MAXCOPY + 2 * NALIGN + 16)
+
+static uint8_t cbuf[COPYBUF] __attribute__((aligned(8)));
+static uint8_t cwant[COPYBUF] __attribute__((aligned(8)));
+static uint8_t csrc[COPYBUF] __attribute__((aligned(8)));
+
+// Fill b with a pattern that differs from the last one.
+static void
+mkpattern(uint8_t *b, int n)
+{
+	static int seed;
+	int i;
+
+	seed++;
+	for (i = 0; i < n; i++)
+		b[i] = i * 251 + seed * 7;
+}
+
+static void
+test_copy(void)
+{
+	int da, sa, len, i, c;
+
+	// memcpy and memset: every destination and source alignment;
+	// the bytes around the destination must not change.
+	for (da = 0; da < NALIGN; da++)
+		for (len = 0; len <= MAXCOPY; len++) {
+			for (sa = 0; sa < NALIGN; sa++) {
+				mkpattern(cbuf, COPYBUF);
+				mkpattern(csrc, COPYBUF);
+				memmove(cwant, cbuf, COPYBUF);
+				for (i = 0; i < len; i++)
+					cwant[8 + da + i] = csrc[sa + i];
+				memcpy_generic(cbuf + 8 + da, csrc + sa, len);
+				if (memcmp(cbuf, cwant, COPYBUF) != 0)
+					fail("memcpy", da * NALIGN + sa, len, -1);
+			}
+			for (c = 0; c < 256; c += 0x7F) {
+				mkpattern(cbuf, COPYBUF);
+				memmove(cwant, cbuf, COPYBUF);
+				for (i = 0; i < len; i++)
+					cwant[8 + da + i] = c;
+				memset_generic(cbuf + 8 + da, c | 0x100, len);
+				if (memcmp(cbuf, cwant, COPYBUF) != 0)
+					fail("memset", da, len, c);
+			}
+		}
+
+	// memmove within one buffer, overlapping either way by every
+	// distance up to 2 * NALIGN, from every alignment.
+	for (da = 0; da < 2 * NALIGN; da++)
+		for (sa = 0; sa < 2 * NALIGN; sa++)
+			for (len = 0; len <= MAXCOPY; len++) {
+				mkpattern(cbuf, COPYBUF);
+				memmove(cwant, cbuf, COPYBUF);
+				for (i = 0; i < len; i++)
+					cwant[8 + da + i] = cbuf[8 + sa + i];
+				memmove(cbuf + 8 + da, cbuf + 8 + sa, len);
+				if (memcmp(cbuf, cwant, COPYBUF) != 0)
+					fail("memmove", da * 2 * NALIGN + sa, len, -1);
+			}
+}
+
+// Check that fmt and the arguments after it format as want.
+static void
+checkfmt(const char *want, const char *fmt, ...)
+{
+	char buf[64];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	if (strcmp(buf, want) != 0) {
+		fail("printfmt", -1, -1, -1);
+		printf("  \"%s\" gave \"%s\", not \"%s\"\n", fmt, buf, want);
+	}
+}
+
+static void
+test_printnum(void)
+{
+	static const unsigned long long edges[] = {
+		0, 9, 10, 99, 100, 999999999, 1000000000, 0xFFFFFFFF,
+		0x100000000ULL, 9999999999ULL, 999999999999999999ULL,
+		1000000000000000000ULL, ~0ULL,
+	};
+	static const unsigned bases[] = { 8, 10, 16 };
+	char d1[24], d2[24], *p1, *p2;
+	unsigned long long num, x = 1;
+	int i, b;
+
+	for (i = 0; i < (int) ARRAY_SIZE(edges) + 10000; i++) {
+		if (i < (int) ARRAY_SIZE(edges))
+			num = edges[i];
+		else {
+			// Random, of random size
+			x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+			num = x >> (x % 64);
+		}
+		for (b = 0; b < (int) ARRAY_SIZE(bases); b++) {
+			p1 = fmtdigits(d1 + sizeof(d1), num, bases[b]);
+			p2 = old_digits(d2 + sizeof(d2), num, bases[b]);
+			if (d1 + sizeof(d1) - p1 != d2 + sizeof(d2) - p2
+			    || memcmp(p1, p2, d2 + sizeof(d2) - p2) != 0)
+				fail("fmtdigits", bases[b], d2 + sizeof(d2) - p2, i);
+		}
+	}
+
+	checkfmt("0 -1 2147483647 -2147483648", "%d %d %d %d",
+		 0, -1, 2147483647, -2147483647 - 1);
+	checkfmt("4294967295 deadbeef 010", "%u %x %o", ~0U, 0xdeadbeef, 8);
+	checkfmt("00001234|42    |  7", "%08x|%-6d|%3d", 0x1234, 42, 7);
+	checkfmt("1234567890123456789 123456789abcdef", "%llu %llx",
+		 1234567890123456789ULL, 0x123456789abcdefULL);
+	checkfmt("-1000000000000000000", "%lld", -1000000000000000000LL);
+}
+
+
+// Nanoseconds per call of fn(p, q), the best of a few runs, with
+// about 'bytes' bytes looked at in each.
+static double
+bench(int (*fn)(const char *, const char *), const char *p,
+      const char *q, int bytes)
+{
+	int (*volatile f)(const char *, const char *) = fn;
+	unsigned long long t, best = ~0ULL;
+	int i, run, n = (1 << 24) / (bytes + 32);
+
+	for (run = 0; run < 5; run++) {
+		t = host_nsec();
+		for (i = 0; i < n; i++)
+			sink += f(p, q);
+		t = host_nsec() - t;
+		best = MIN(best, t);
+	}
+	return (double) best / n;
+}
+
+// The number and base for fmtdigits
+static unsigned long long bnum;
+static unsigned bbase;
+static char bdigits[24];
+
+static void
+report(const char *what, int len, double old, double new)
+{
+	printf("%-16s %5d: old %8.1f ns, new %8.1f ns, %5.2fx\n",
+	       what, len, old, new, old / new);
+}
+
+// Each routine as an int (*)(const char *, const char *), for bench.
+#define BENCHFN(name, expr)						\
+	static int name(const char *p, const char *q) { return (expr); }
+
+BENCHFN(b_strlen, strlen(p))
+BENCHFN(b_old_strlen, old_strlen(p))
+BENCHFN(b_strnlen, strnlen(p, ~0))
+BENCHFN(b_old_strnlen, old_strnlen(p, ~0))
+BENCHFN(b_strfind, *strfind(p, ABSENT))
+BENCHFN(b_old_strfind, *old_strfind(p, ABSENT))
+BENCHFN(b_strcmp, strcmp(p, q))
+BENCHFN(b_old_strcmp, old_strcmp(p, q))
+
+// The length for the memory routines
+static int blen;
+
+BENCHFN(b_memcmp, memcmp(p, q, blen))
+BENCHFN(b_old_memcmp, old_memcmp(p, q, blen))
+BENCHFN(b_memfind, *(char *) memfind(p, ABSENT, blen))
+BENCHFN(b_old_memfind, *(char *) old_memfind(p, ABSENT, blen))
+BENCHFN(b_memcpy, (memcpy_generic((char *) p, q, blen), 0))
+BENCHFN(b_memmove, (memmove((char *) p, q, blen), 0))
+BENCHFN(b_old_memmove, (old_memmove((char *) p, q, blen), 0))
+BENCHFN(b_memset, (memset_generic((char *) p, 0, blen), 0))
+BENCHFN(b_old_memset, (old_memset((char *) p, 0, blen), 0))
+BENCHFN(b_fmtdigits, *fmtdigits(bdigits + sizeof(bdigits), bnum, bbase))
+BENCHFN(b_old_digits, *old_digits(bdigits + sizeof(bdigits), bnum, bbase))
+
+#define BENCHLEN	4096
+
+static char bbuf1[BENCHLEN + 1] __attribute__((aligned(8)));
+static char bbuf2[BENCHLEN + 1] __attribute__((aligned(8)));
+
+static void
+bench_strings(void)
+{
+	static const int lens[] = { 8, 64, 1024, BENCHLEN };
+	int i, len;
+
+	for (i = 0; i < (int) ARRAY_SIZE(lens); i++) {
+		len = lens[i];
+		mkstr(bbuf1, len);
+		mkstr(bbuf2, len);
+		report("strlen", len, bench(b_old_strlen, bbuf1, 0, len),
+		       bench(b_strlen, bbuf1, 0, len));
+		report("strnlen", len, bench(b_old_strnlen, bbuf1, 0, len),
+		       bench(b_strnlen, bbuf1, 0, len));
+		report("strfind", len, bench(b_old_strfind, bbuf1, 0, len),
+		       bench(b_strfind, bbuf1, 0, len));
+		report("strcmp", len, bench(b_old_strcmp, bbuf1, bbuf2, len),
+		       bench(b_strcmp, bbuf1, bbuf2, len));
+	}
+}
+
+static void
+bench_mem(void)
+{
+	static const int lens[] = { 16, 256, BENCHLEN };
+	static const int diffs[] = { 0, 3, 5 };
+	int i;
+
+	mkstr(bbuf1, BENCHLEN);
+	mkstr(bbuf2, BENCHLEN);
+	for (i = 0; i < (int) ARRAY_SIZE(lens); i++) {
+		blen = lens[i];
+		report("memcmp equal", blen,
+		       bench(b_old_memcmp, bbuf1, bbuf2, blen),
+		       bench(b_memcmp, bbuf1, bbuf2, blen));
+		report("memfind", blen,
+		       bench(b_old_memfind, bbuf1, 0, blen),
+		       bench(b_memfind, bbuf1, 0, blen));
+	}
+
+	// Buffers that differ early, at the byte given: going by words
+	// must not cost much over bytes here.
+	blen = BENCHLEN;
+	for (i = 0; i < (int) ARRAY_SIZE(diffs); i++) {
+		bbuf2[diffs[i]]++;
+		report("memcmp differ", diffs[i],
+		       bench(b_old_memcmp, bbuf1, bbuf2, diffs[i]),
+		       bench(b_memcmp, bbuf1, bbuf2, diffs[i]));
+		bbuf2[diffs[i]]--;
+	}
+}
+
+// The sizes the kernel copies: the CGA console scrolls by moving 24
+// lines of 80 two-byte characters up one line, and stage 2 loads ELF
+// segments of odd sizes at odd addresses.
+#define CRT_MOVE	(24 * 80 * 2)
+#define CRT_LINE	(80 * 2)
+#define SEGSIZE		12345
+
+static char mbuf[3 * 16384] __attribute__((aligned(8)));
+
+static void
+bench_copy(void)
+{
+	char *a = mbuf, *b = mbuf + 16384 + 4, *c = mbuf + 2 * 16384 + 1;
+
+	blen = CRT_MOVE;
+	report("memmove scroll", blen, bench(b_old_memmove, a, a + CRT_LINE, blen),
+	       bench(b_memmove, a, a + CRT_LINE, blen));
+	report("memmove back", blen, bench(b_old_memmove, a + CRT_LINE, a, blen),
+	       bench(b_memmove, a + CRT_LINE, a, blen));
+
+	// memcpy used to be memmove
+	blen = SEGSIZE;
+	report("memcpy segment", blen, bench(b_old_memmove, a, b, blen),
+	       bench(b_memcpy, a, b, blen));
+	report("memcpy seg+1", blen, bench(b_old_memmove, a + 1, b + 1, blen),
+	       bench(b_memcpy, a + 1, b + 1, blen));
+	report("memcpy seg skew", blen, bench(b_old_memmove, a, c, blen),
+	       bench(b_memcpy, a, c, blen));
+	report("memmove seg back", blen, bench(b_old_memmove, a + 3, a, blen),
+	       bench(b_memmove, a + 3, a, blen));
+	report("memset segment", blen, bench(b_old_memset, a + 1, 0, blen),
+	       bench(b_memset, a + 1, 0, blen));
+}
+
+// On a 64-bit host, 64-bit division is one instruction rather than a
+// call to libgcc as in the kernel, so this understates the gain there.
+static void
+bench_printnum(void)
+{
+	static const struct {
+		const char *what;
+		unsigned long long num;
+		unsigned base;
+	} nums[] = {
+		{ "digits %u", 42, 10 },
+		{ "digits %u", 3141592653U, 10 },
+		{ "digits %llu", 12345678901234567890ULL, 10 },
+		{ "digits %x", 0xf0100000, 16 },
+		{ "digits %llx", 0x123456789abcdefULL, 16 },
+	};
+	int i, len;
+
+	for (i = 0; i < (int) ARRAY_SIZE(nums); i++) {
+		bnum = nums[i].num;
+		bbase = nums[i].base;
+		len = bdigits + sizeof(bdigits)
+			- old_digits(bdigits + sizeof(bdigits), bnum, bbase);
+		report(nums[i].what, len, bench(b_old_digits, 0, 0, len),
+		       bench(b_fmtdigits, 0, 0, len));
+	}
+}
+
+int
+libtest(void)
+{
+	test_strings();
+	test_mem();
+	test_copy();
+	test_printnum();
+	if (nfail) {
+		printf("libtest: %d failures\n", nfail);
+		return -1;
+	}
+	printf("libtest: all tests passed\n");
+	bench_strings();
+	bench_mem();
+	bench_copy();
+	bench_printnum();
+	return 0;
+}
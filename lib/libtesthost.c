@@ -0,0 +1,42 @@
+// The parts of the lib/libtest.c harness that need the host's C library.
+// Kept apart from libtest.c, which is built against JOS's headers.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+int libtest(void);
+
+unsigned long long
+host_nsec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Return n bytes of memory that end where an unmapped page begins.
+char *
+host_guard(int n)
+{
+	long pgsize = sysconf(_SC_PAGESIZE);
+	long sz = (n + pgsize - 1) / pgsize * pgsize;
+	char *p;
+
+	p = mmap(NULL, sz + pgsize, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED || mprotect(p + sz, pgsize, PROT_NONE) < 0) {
+		perror("libtest: mmap");
+		exit(1);
+	}
+	return p + sz - n;
+}
+
+int
+main(void)
+{
+	return libtest() ? 1 : 0;
+}
@@ -29,9 +29,129 @@ static const char * const error_string[MAXERROR] =
 };
 
 
-static void printstring(void(*putch)(int, void*), void *putdat, const char* s) {
-	while (*s) {
-		putch(*s++, putdat);
+/*
+ * Where the output goes: one character at a time to putch, or, if
+ * there is a write function, whole spans at once (runs of literal
+ * text, strings, numbers and padding).  putch and write must go to
+ * the same place, in order.
+ */
+struct fmtout {
+	void (*putch)(int, void*);
+	void (*write)(const char*, size_t, void*);
+	void *putdat;
+};
+
+static void
+fmtwrite(struct fmtout *out, const char *s, size_t n)
+{
+	if (out->write) {
+		if (n > 0)
+			out->write(s, n, out->putdat);
+	} else
+		while (n-- > 0)
+			out->putch(*s++, out->putdat);
+}
+
+// Output 'n' copies of 'c', if n > 0.
+static void
+fmtpad(struct fmtout *out, int c, int n)
+{
+	char pad[16];
+	int m;
+
+	if (!out->write) {
+		while (n-- > 0)
+			out->putch(c, out->putdat);
+		return;
+	}
+	if (n <= 0)
+		return;
+	memset(pad, c, sizeof(pad));
+	for (; n > 0; n -= m) {
+		m = MIN(n, (int) sizeof(pad));
+		out->write(pad, m, out->putdat);
+	}
+}
+
+static void printstring(struct fmtout *out, const char* s) {
+	fmtwrite(out, s, strlen(s));
+}
+
+// "00" through "99", for converting decimal two digits at a time.
+static const char digit_pairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+// Write n in decimal into the bytes before p; return the first digit.
+// Only uses 32-bit division, which the compiler does inline.
+static char *
+fmtdec32(char *p, uint32_t n)
+{
+	uint32_t q;
+
+	while (n >= 100) {
+		q = n / 100;
+		p -= 2;
+		p[0] = digit_pairs[(n - q * 100) * 2];
+		p[1] = digit_pairs[(n - q * 100) * 2 + 1];
+		n = q;
+	}
+	if (n >= 10) {
+		p -= 2;
+		p[0] = digit_pairs[n * 2];
+		p[1] = digit_pairs[n * 2 + 1];
+	} else
+		*--p = '0' + n;
+	return p;
+}
+
+// Write num in base into the bytes before p; return the first digit.
+// 64-bit division goes through libgcc (__udivdi3 and __umoddi3), so
+// it is avoided where it can be: bases 8 and 16 shift, and decimal
+// takes off nine digits per 64-bit division until the rest fits in
+// 32 bits.
+static char *
+fmtdigits(char *p, unsigned long long num, unsigned base)
+{
+	unsigned long long q;
+	char *s;
+	int shift;
+
+	switch (base) {
+	case 10:
+		while (num > 0xFFFFFFFF) {
+			q = num / 1000000000;
+			s = fmtdec32(p, num - q * 1000000000);
+			p -= 9;
+			while (s > p)
+				*--s = '0';
+			num = q;
+		}
+		return fmtdec32(p, num);
+
+	case 8:
+	case 16:
+		shift = (base == 8 ? 3 : 4);
+		do {
+			*--p = "0123456789abcdef"[num & (base - 1)];
+			num >>= shift;
+		} while (num);
+		return p;
+
+	default:
+		do {
+			*--p = "0123456789abcdef"[num % base];
+			num /= base;
+		} while (num);
+		return p;
 	}
 }
 
@@ -39,43 +159,26 @@ static void printstring(void(*putch)(int, void*), void *putdat, const char* s) {
  * Print a number (base <= 16) in reverse order,
  * using specified putch function and associated pointer putdat.
  */
-static int printnum(void (*putch)(int, void*), void *putdat,
+static int printnum(struct fmtout *out,
 	 unsigned long long num, unsigned base, int width, int padc, int laflag)
 {
 	// if cprintf'parameter includes pattern of the form "%-", padding
 	// space on the right side if neccesary.
 	// you can add helper function if needed.
 
-	unsigned char digits[sizeof(unsigned long long) * 8] = {0};
-	int len = 0;
-	unsigned long long n = num; 
-
-	do {
-		digits[len++] = n % base;
-		n /= base;
-	} while (n);
+	// the digits, least significant last
+	char digits[sizeof(unsigned long long) * 8];
+	char *p = fmtdigits(digits + sizeof(digits), num, base);
+	int len = digits + sizeof(digits) - p;
 
 	int npad = width - len;
 	if (!laflag)
-	{
-		while (npad-- > 0)
-		{
-			putch(padc, putdat);
-		}
-	}
+		fmtpad(out, padc, npad);
 
-	int i;
-	for (i = len-1; i >= 0; --i) {
-		putch("0123456789abcdef"[digits[i]], putdat);
-	}
+	fmtwrite(out, p, len);
 
 	if (laflag)
-	{
-		while (npad-- > 0)
-		{
-			putch(padc, putdat);
-		}
-	}
+		fmtpad(out, padc, npad);
 
 /*
 	// first recursively print all preceding (more significant) digits
@@ -123,9 +226,9 @@ getint(va_list *ap, int lflag)
 }
 
 
-void my_putch(void (*putch)(int, void*), void *putdat, char ch, int* counter)
+static void my_putch(struct fmtout *out, char ch, int* counter)
 {
-	putch(ch, putdat);
+	out->putch(ch, out->putdat);
 	counter[0]++;
 }
 
@@ -136,27 +239,49 @@ void printfmt(void (*putch)(int, void*), void *putdat, const char *fmt, ...);
 void
 vprintfmt(void (*putch)(int, void*), void *putdat, const char *fmt, va_list ap)
 {
+	vprintfmt_write(putch, NULL, putdat, fmt, ap);
+}
+
+// Like vprintfmt, but output that comes in spans goes to 'write', if
+// not NULL, a span at a time; the rest goes to 'putch'.
+void
+vprintfmt_write(void (*putch)(int, void*),
+		void (*write)(const char*, size_t, void*),
+		void *putdat, const char *fmt, va_list args)
+{
+	struct fmtout o = { putch, write, putdat }, *out = &o;
+	// getint and getuint are passed &ap.  Where va_list is an array
+	// type (not on i386), &args would not be a va_list *, so they
+	// work on a copy.
+	va_list ap;
 	register const char *p;
 	register int ch, err;
 	unsigned long long num;
 	int base, lflag, width, precision, altflag, dsplflag, laflag;
+	int len;
 	char padc;
 
 	int n_char_put = 0;
 
+	va_copy(ap, args);
+
 	// printstring(putch, putdat, "DEBUG: fmt='");
 	// printstring(putch, putdat, fmt);
 	// printstring(putch, putdat, "'\n");
 
 	while (1) {
-		while ((ch = *(unsigned char *) fmt++) != '%') {
-			if (ch == '\0') {
-				// printstring(putch, putdat, "\nDEBUG: n_char_put=");
-				// printnum(putch, putdat, n_char_put, 10, -1, ' ');
-				// printstring(putch, putdat, "\n");
-				return;
-			}
-			my_putch(putch, putdat, ch, &n_char_put);
+		// the literal text up to the next %-escape, at once
+		for (p = fmt; *p != '%' && *p != '\0'; p++)
+			/* do nothing */;
+		fmtwrite(out, fmt, p - fmt);
+		n_char_put += p - fmt;
+		fmt = p;
+		if ((ch = *(unsigned char *) fmt++) == '\0') {
+			// printstring(putch, putdat, "\nDEBUG: n_char_put=");
+			// printnum(putch, putdat, n_char_put, 10, -1, ' ');
+			// printstring(putch, putdat, "\n");
+			va_end(ap);
+			return;
 		}
 
 		// Process a %-escape sequence
@@ -226,7 +351,7 @@ vprintfmt(void (*putch)(int, void*), void *putdat, const char *fmt, va_list ap)
 
 		// character
 		case 'c':
-			my_putch(putch, putdat, va_arg(ap, int), &n_char_put);
+			my_putch(out, va_arg(ap, int), &n_char_put);
 			break;
 
 		// error message
@@ -237,23 +362,32 @@ vprintfmt(void (*putch)(int, void*), void *putdat, const char *fmt, va_list ap)
 			if (err >= MAXERROR || (p = error_string[err]) == NULL)
 				printfmt(putch, putdat, "error %d", err);
 			else
-				printfmt(putch, putdat, "%s", p);
+				printstring(out, p);
 			break;
 
 		// string
 		case 's':
 			if ((p = va_arg(ap, char *)) == NULL)
 				p = "(null)";
-			if (width > 0 && padc != '-')
-				for (width -= strnlen(p, precision); width > 0; width--)
-					my_putch(putch, putdat, padc, &n_char_put);
-			for (; (ch = *p++) != '\0' && (precision < 0 || --precision >= 0); width--)
-				if (altflag && (ch < ' ' || ch > '~'))
-					my_putch(putch, putdat, '?', &n_char_put);
-				else
-					my_putch(putch, putdat, ch, &n_char_put);
-			for (; width > 0; width--)
-				my_putch(putch, putdat, ' ', &n_char_put);
+			len = strnlen(p, precision);
+			if (width > 0 && padc != '-') {
+				fmtpad(out, padc, width - len);
+				n_char_put += MAX(width - len, 0);
+				width = MIN(width - len, 0);
+			}
+			if (altflag)
+				for (; (ch = *p++) != '\0' && (precision < 0 || --precision >= 0); width--)
+					if (ch < ' ' || ch > '~')
+						my_putch(out, '?', &n_char_put);
+					else
+						my_putch(out, ch, &n_char_put);
+			else {
+				fmtwrite(out, p, len);
+				n_char_put += len;
+				width -= len;
+			}
+			fmtpad(out, ' ', width);
+			n_char_put += MAX(width, 0);
 			break;
 
 		// (signed) decimal
@@ -272,14 +406,14 @@ vprintfmt(void (*putch)(int, void*), void *putdat, const char *fmt, va_list ap)
 		case 'o':
 			// Replace this with your code.
 			num = getint(&ap, lflag);
-			my_putch(putch, putdat, '0', &n_char_put);
+			my_putch(out, '0', &n_char_put);
 			base = 8;
 			goto number;
 
 		// pointer
 		case 'p':
-			my_putch(putch, putdat, '0', &n_char_put);
-			my_putch(putch, putdat, 'x', &n_char_put);
+			fmtwrite(out, "0x", 2);
+			n_char_put += 2;
 			num = (unsigned long long)
 				(uintptr_t) va_arg(ap, void *);
 			base = 16;
@@ -291,14 +425,14 @@ vprintfmt(void (*putch)(int, void*), void *putdat, const char *fmt, va_list ap)
 			base = 16;
 		number:
 			if ((long long) num < 0) {
-				my_putch(putch, putdat, '-', &n_char_put);
+				my_putch(out, '-', &n_char_put);
 				num = -(long long) num;
 			}
 			else if (num >= 0 && dsplflag)
 			{
-				my_putch(putch, putdat, '+', &n_char_put);
+				my_putch(out, '+', &n_char_put);
 			}
-			n_char_put += printnum(putch, putdat, num, base, width, padc, laflag);
+			n_char_put += printnum(out, num, base, width, padc, laflag);
 			break;
 
 		case 'n': {
@@ -322,10 +456,10 @@ vprintfmt(void (*putch)(int, void*), void *putdat, const char *fmt, va_list ap)
 				  const char *overflow_error = "\nwarning! The value %n argument pointed to has been overflowed!\n";
 				  signed char* p = va_arg(ap, signed char*);
 				  if (n_char_put > 127) {
-					  printstring(putch, putdat, overflow_error);
+					  printstring(out, overflow_error);
 				  }
 				  if (!p) {
-				      printstring(putch, putdat, null_error);
+				      printstring(out, null_error);
 				  } else {
 					  *p = n_char_put;
 				  }
@@ -334,12 +468,12 @@ vprintfmt(void (*putch)(int, void*), void *putdat, const char *fmt, va_list ap)
 
 		// escaped '%' character
 		case '%':
-			my_putch(putch, putdat, ch, &n_char_put);
+			my_putch(out, ch, &n_char_put);
 			break;
 
 		// unrecognized escape sequence - just print it literally
 		default:
-			my_putch(putch, putdat, '%', &n_char_put);
+			my_putch(out, '%', &n_char_put);
 			for (fmt--; fmt[-1] != '%'; fmt--)
 				/* do nothing */;
 			break;
@@ -371,6 +505,16 @@ sprintputch(int ch, struct sprintbuf *b)
 		*b->buf++ = ch;
 }
 
+static void
+sprintwrite(const char *s, size_t n, struct sprintbuf *b)
+{
+	size_t m = MIN(n, (size_t) (b->ebuf - b->buf));
+
+	b->cnt += n;
+	memmove(b->buf, s, m);
+	b->buf += m;
+}
+
 int
 vsnprintf(char *buf, int n, const char *fmt, va_list ap)
 {
@@ -380,7 +524,7 @@ vsnprintf(char *buf, int n, const char *fmt, va_list ap)
 		return -E_INVAL;
 
 	// print the string to the buffer
-	vprintfmt((void*)sprintputch, &b, fmt, ap);
+	vprintfmt_write((void*)sprintputch, (void*)sprintwrite, &b, fmt, ap);
 
 	// null terminate the buffer
 	*b.buf = '\0';
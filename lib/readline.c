@@ -21,7 +21,7 @@ readline(const char *prompt)
 			return NULL;
 		} else if ((c == '\b' || c == '\x7f') && i > 0) {
 			if (echoing)
-				cputchar('\b');
+				cputs("\b \b", 3);
 			i--;
 		} else if (c >= ' ' && i < BUFLEN-1) {
 			if (echoing)